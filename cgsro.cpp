@@ -37,74 +37,195 @@
 #include "cgsro_sequential.h"
 #include "cgsro_multicore.h"
 #include "cgsro_gpu.h"
+#include "cgsro_blas.h"
+#include "cgsro_tsqr.h"
+#include "cgsro_cholqr.h"
+#include "cgsro_rgs.h"
+#include "cgsro_mixed.h"
+#include "cgsro_complex.h"
+#include "cgsro_distributed.h"
+#include "cgsro_refcache.h"
+#include "cgsro_checkpoint.h"
+#include "cgsro_telemetry.h"
+#include "cgsro_verifier.h"
 
-void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
+#include "string.h"
+
+// CGS-RO driver for the scalar type T of A and Q (float, double or long double), A is given in double
+template <typename T>
+void run_cgsro_scalar( long long m, long long n, int ro_steps, int target, double ** A){
     
-    printf("A [%d x %d] \n", m, n); 
+    printf("A [%lld x %lld], precision = %s \n", m, n, scalarTypeName<T>()); 
 
     // If 1 then the loss orthogonality test if performed
     int performOrthogonalityTest = 1;
 
+    // If 1 then the sequential reference (Q, timers, loss of orthogonality) is cached in refCacheDir and reused by 
+    // later runs with the same A, m, n, s and precision, results of the parallel runs are compared with the reference Q
+    int useRefCache = 1;
+    const char * refCacheDir = "cgsro_ref_cache";
+    RefCache * ref = new RefCache[ro_steps];
+
+    // If 1 (and code is compiled with -DCGSRO_CBLAS) then the multicore CGS-RO is repeated 
+    // with the projection step routed through CBLAS and compared with the native loops
+    int compareProjectionBackends = 1;
+
+    // If 1 then dots and norms of the CPU engines are summed in fixed row-blocks of REPRO_BLOCK rows combined in a fixed 
+    // order (helpers.cpp), so Q is bitwise the same for any number of threads (the CBLAS projection is not compared then)
+    int reproducibleReductions = 0;
+    setReproducibleReductions( reproducibleReductions );
+
+    // If 1 then the column loops of the sequential and multicore CGS-RO store finished columns of Q in checkpointDir 
+    // (at most every checkpointPeriod seconds, written back in the background): a rerun of a killed run resumes there
+    int useCheckpoint = 0;
+    const char * checkpointDir = "cgsro_checkpoint";
+    double checkpointPeriod = 60.0;
+    setCheckpoint( useCheckpoint == 1 ? checkpointDir : NULL, checkpointPeriod);
+
+    // If 1 then the sequential, multicore and GPU column loops publish their progress (columns, passes, bytes streamed,
+    // GB/s) to the shared-memory page telemetryShm (./cgsro_client monitor /cgsro_telemetry) and, if telemetryTextfile
+    // is set, to a Prometheus textfile, both refreshed every telemetryPeriod seconds
+    int useTelemetry = 0;
+    const char * telemetryShm = "/cgsro_telemetry";
+    const char * telemetryTextfile = NULL;
+    double telemetryPeriod = 1.0;
+    if (useTelemetry == 1)
+        setTelemetry( telemetryShm, telemetryTextfile, telemetryPeriod);
+
+    // If 1 then the loss of orthogonality test of the multicore CGS-RO (target = 1) runs on verifierThreads threads 
+    // concurrently with the column loop (finished panels of Q), the run is aborted once an entry of I - Q^T*Q exceeds 
+    // verifierThreshold (leave verifierThreads cores to the verifier, e.g. with ACC_NUM_CORES)
+    int overlapOrthogonalityTest = 0;
+    int verifierThreads = 2;
+    double verifierThreshold = (sizeof(T) == sizeof(float)) ? 1e-2 : 1e-6;
+
+    // If 1 then the multicore CGS-RO (target = 1) is rank-revealing: a column whose norm falls below rankTolerance*||aj|| 
+    // in a projection pass is dropped from Q and later columns are not projected against it; the numerical rank and the 
+    // dropped columns are printed and the loss of orthogonality test covers the rank columns of Q
+    int rankRevealing = 0;
+    double rankTolerance = (sizeof(T) == sizeof(float)) ? 1e-4 : 1e-10;
+    long long * perm = (rankRevealing == 1) ? (long long*)mallocChecked( n, 1, 1, sizeof(long long)) : NULL;
+    long long rank = n;
+
+    // If 1 then A is also given to the multicore CGS-RO (target = 1) in CSC format: the first projection pass of 
+    // sparse columns reads only rows of Q which correspond to nonzeros of aj
+    int useSparseInput = 1;
+    CscMatrix<T> * A_csc = NULL;
+
 
     // Arrays to store the times taken by computations in CGS-RO
     double ** timer_seq  = new double*[ro_steps];
     double ** timer_acc  = new double*[ro_steps];
+    double ** timer_blas = new double*[ro_steps];
     
-    for(int i = 0; i < ro_steps; ++i){
+    for(long long i = 0; i < ro_steps; ++i){
         timer_seq[i]  = new double[9];
         timer_acc[i]  = new double[9];
+        timer_blas[i] = new double[9];
     }
 
-    double * A_1d = (double*)malloc(sizeof(double)*m*n);
+    // Number of row-blocks (leaves of the reduction tree) in TSQR (target = 3)
+    int tsqr_blocks = 64;
+
+    // Randomized Gram-Schmidt (target = 5): sketch type (1 - sparse sign, 2 - SRHT) and sketch size k ~ 2n
+    int rgs_sketch_type = 1;
+    long long rgs_sketch_size = rgsSketchSize( 2*n, m, n);
+    T * S_1d = NULL; // sketch of Q: Theta*Q (k x n)
+
+    // Mixed-precision CGS-RO (target = 6): storage of A and Q (1 - float, 2 - bfloat16, 3 - fp16) 
+    // and refinement of Q in precision T (1 - yes, 0 - no)
+    int mixed_storage = 1;
+    int mixed_refine  = 1;
+
+    // Complex CGS-RO (target = 7): if 1 then the 2x real embedding [Re -Im; Im Re] of A is orthogonalized 
+    // with the multicore CGS-RO and compared with the complex implementation
+    int compareRealEmbedding = 1;
+    double ** timer_emb = new double*[ro_steps];
+    for(long long i = 0; i < ro_steps; ++i)
+        timer_emb[i] = new double[9];
+
+    // Distributed CGS-RO (target = 8): number of processes of the shared-memory stand-in (with -DCGSRO_MPI given by mpirun)
+    int dist_procs = 4;
+
+    // there is no CBLAS gemv for long double, its reductions are not reproducible
+    if (compareProjectionBackends == 1 && (!cblasAvailable() || sizeof(T) > sizeof(double) || reproducibleReductions == 1))
+        compareProjectionBackends = 0;
+
+    T * A_1d = (T*)mallocChecked(m, n, 1, sizeof(T));
     
     // used in sequential implementation:
-    double * Q_1d = (double*)malloc(sizeof(double)*m*n);
+    T * Q_1d = (T*)mallocChecked(m, n, 1, sizeof(T));
 
     // used in multicore implementation:
-    double * Qmulticore_1d;
+    T * Qmulticore_1d = NULL;
+
+    // used in complex implementation (A_c, Q_c) and its real embedding (2m x 2n):
+    std::complex<T> * Ac_1d = NULL;
+    std::complex<T> * Qc_1d = NULL;
+    T * Aemb_1d = NULL;
+    T * Qemb_1d = NULL;
 
     // used in gpu implementation:
-    double * Qgpu_1d ;
-    double * v_1d  ;
+    T * Qgpu_1d = NULL;
+    T * v_1d = NULL;
 
     // initialize data for CGSRO implementations:
 
-    // A (2D -> 1D)
-    for(int j = 0; j < n; j++){
-        for(int i = 0; i < m; i++){
-            A_1d[i + j*m] = A[i][j];
-        }
-    }
+    // A (2D -> 1D): blocked parallel transpose once, later copies of A are taken from A_1d
+    double t_setup = mclock();
+    transposeToColumnMajor( A, A_1d, m, n);
 
     // initialization for sequential 
-    for(int j = 0; j < n; j++){
-        for(int i = 0; i < m; i++){
+    for(long long j = 0; j < n; j++){
+        for(long long i = 0; i < m; i++){
             Q_1d[i + j*m]   = 0.0;
         }
     }
 
-    // initialization for multicore
-    if (target == 1){
-        Qmulticore_1d = (double*)malloc(sizeof(double)*m*n);
-        for(int j = 0; j < n; j++){
-            for(int i = 0; i < m; i++){
-                Qmulticore_1d[i + j*m] = A[i][j];
-            }
-        }
+    // initialization for multicore, TSQR, CholeskyQR, RGS, mixed-precision and distributed
+    if (target == 1 || (target >= 3 && target <= 6) || target == 8){
+        Qmulticore_1d = (T*)mallocChecked(m, n, 1, sizeof(T));
+        memcpy( Qmulticore_1d, A_1d, m*n*sizeof(T));
     } 
     
-    // initialization for gpu:
-    if (target == 2){
-        Qgpu_1d = (double*)malloc(sizeof(double)*m*n);
-        v_1d = (double*)malloc(sizeof(double)*m*n);
-   
-        for(int j = 0; j < n; j++){
-            for(int i = 0; i < m; i++){
-                Qgpu_1d[i + j*m] = A[i][j];
-                v_1d[i+j*m] = A[i][j];
+    if (target == 1 && useSparseInput == 1){
+        A_csc = cscFromDense( A_1d, m, n);
+        printf("A in CSC format: nnz = %lld [%1.3f %%]\n", A_csc->nnz, 100.0*(double)A_csc->nnz/((double)m*(double)n));
+    }
+
+    // initialization for complex: entries of A are rotated by a phase which depends on the row and the column
+    if (target == 7){
+        Ac_1d = (std::complex<T>*)mallocChecked(m, n, 1, sizeof(std::complex<T>));
+        Qc_1d = (std::complex<T>*)mallocChecked(m, n, 1, sizeof(std::complex<T>));
+        for(long long j = 0; j < n; j++){
+            for(long long i = 0; i < m; i++){
+                double phase = 0.5 * (double)((7*i + 3*j) % 13);
+                Ac_1d[i + j*m] = std::complex<T>( A_1d[i + j*m]*cos(phase), A_1d[i + j*m]*sin(phase));
             }
         }
+        if (compareRealEmbedding == 1){
+            Aemb_1d = (T*)mallocChecked(2*m, 2*n, 1, sizeof(T));
+            Qemb_1d = (T*)mallocChecked(2*m, 2*n, 1, sizeof(T));
+            for(long long j = 0; j < n; j++){
+                for(long long i = 0; i < m; i++){
+                    Aemb_1d[i     + j*2*m]     =  Ac_1d[i + j*m].real();
+                    Aemb_1d[i + m + j*2*m]     =  Ac_1d[i + j*m].imag();
+                    Aemb_1d[i     + (j+n)*2*m] = -Ac_1d[i + j*m].imag();
+                    Aemb_1d[i + m + (j+n)*2*m] =  Ac_1d[i + j*m].real();
+                }
+            }
+        }
+    }
+
+    // initialization for gpu:
+    if (target == 2){
+        Qgpu_1d = (T*)mallocChecked(m, n, 1, sizeof(T));
+        v_1d = (T*)mallocChecked(m, n, 1, sizeof(T));
+        memcpy( Qgpu_1d, A_1d, m*n*sizeof(T));
+        memcpy( v_1d, A_1d, m*n*sizeof(T));
     }
+    t_setup = mclock() - t_setup;
+    printf("[SETUP] A (row-major) -> A_1d (column-major) and the copies of A [TIME: %1.3f s]\n", t_setup);
 
     // GPU warmup: 
     if(target==2){
@@ -116,14 +237,51 @@ void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
 
     printf("CGS-RO (reference: sequential on a CPU) :\n"); 
     for (int s = 1; s <= ro_steps; s++){
+
+        ref[s-1].map = NULL;
+        unsigned long long key = 0;
+        if (useRefCache == 1){
+            key = refCacheKey( A_1d, m, n, s);
+            if (refCacheLoad( refCacheDir, key, m, n, s, sizeof(T), &ref[s-1])){
+                for (int ii = 0; ii < 9; ii++)
+                    timer_seq[s-1][ii] = ref[s-1].timer[ii];
+                printf("[REF CACHE] %016llx: sequential CGS-RO [%1.3f s] is taken from the cache\n", key, timer_seq[s-1][8]);
+
+                if (performOrthogonalityTest ==1){
+                    if (ref[s-1].norm >= 0.0)
+                        printf("[CGS-RO][re-ortho #%d] NormInf(I-Q^T*Q) = %1.3e [cached]\n", s, ref[s-1].norm);
+                    else
+                        othogonalityTest((T*)ref[s-1].Q, m, n, s );
+                }
+                continue;
+            }
+        }
         
-        cgsro_sequential ( A_1d, Q_1d, s, m, n, timer_seq);
+        long long j0 = cgsro_sequential ( A_1d, Q_1d, s, m, n, timer_seq);
 
+        double norm = -1.0;
         if (performOrthogonalityTest ==1)
-            othogonalityTest(Q_1d, m, n, s );
+            norm = othogonalityTest(Q_1d, m, n, s );
+
+        // a resumed run has timed only columns j0..n-1: its timers must not become the cached reference
+        if (j0 > 0)
+            printf("[CHECKPOINT] sequential CGS-RO resumed at column %lld: its time (and the speedups) cover columns %lld..%lld only, it is not cached\n", 
+                   j0, j0, n-1);
+
+        // the new entry is mapped for the comparison with parallel results
+        if (useRefCache == 1 && j0 == 0 && refCacheStore( refCacheDir, key, Q_1d, m, n, s, sizeof(T), timer_seq[s-1], norm)){
+            printf("[REF CACHE] %016llx: sequential CGS-RO is stored in %s\n", key, refCacheDir);
+            refCacheLoad( refCacheDir, key, m, n, s, sizeof(T), &ref[s-1]);
+        }
     }
 
 
+    // columns done by a run which the overlapped orthogonality test has aborted (-1 if it was not), such Q is 
+    // incomplete: neither compared with the reference nor timed against it
+    long long * aborted = new long long[ro_steps];
+    for (int s = 0; s < ro_steps; s++)
+        aborted[s] = -1;
+
     printf("\nCGS-RO with OPENACC:\n"); 
     double tcgs1 = mclock();
     for (int s = 1; s <= ro_steps; s++){
@@ -131,7 +289,105 @@ void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
         if (target==1){ // CPU:
             printf("CGS-RO (TARGET=MULTICORE):\n"); 
             
-            cgsro_multicore ( A_1d, Qmulticore_1d, s, m, n, timer_acc );
+            if (performOrthogonalityTest == 1 && overlapOrthogonalityTest == 1)
+                verifierBegin( Qmulticore_1d, m, n, verifierThreads, verifierThreshold);
+
+            rank = cgsro_multicore ( A_1d, Qmulticore_1d, s, m, n, timer_acc, A_csc, perm, rankTolerance );
+            if (perm != NULL){
+                printf("[RANK][re-ortho #%d] numerical rank = %lld of %lld, dropped columns:", s, rank, n);
+                long long ndropped = 0;
+                while (rank + ndropped < n && perm[rank + ndropped] >= 0)
+                    ndropped++;
+                for (long long i = rank; i < rank + ndropped && i < rank + 16; i++)
+                    printf(" %lld", perm[i]);
+                printf("%s\n", (ndropped > 16) ? " ..." : (ndropped == 0 ? " none" : ""));
+                if (rank + ndropped < n)
+                    printf("[RANK][re-ortho #%d] stopped by the verifier, columns %lld..%lld were not processed\n", s, rank + ndropped, n-1);
+            }
+  
+            if (performOrthogonalityTest == 1 && overlapOrthogonalityTest == 1)
+                verifierEnd( s, &aborted[s-1] );
+            else if (performOrthogonalityTest ==1)
+                othogonalityTest(Qmulticore_1d, m, rank, s );
+
+            if (compareProjectionBackends == 1){
+                setProjectionBackend(1);
+                printf("CGS-RO (TARGET=MULTICORE, PROJECTION=%s):\n", projectionBackendName()); 
+
+                cgsro_multicore ( A_1d, Qmulticore_1d, s, m, n, timer_blas, A_csc );
+
+                if (performOrthogonalityTest ==1)
+                    othogonalityTest(Qmulticore_1d, m, n, s );
+                setProjectionBackend(0);
+            }
+        }
+        if (target==3){ // CPU, TSQR:
+            printf("CGS-RO (TARGET=MULTICORE, TSQR):\n"); 
+            
+            cgsro_tsqr ( A_1d, Qmulticore_1d, tsqr_blocks, m, n, s, timer_acc );
+  
+            if (performOrthogonalityTest ==1)
+                othogonalityTest(Qmulticore_1d, m, n, s );
+        }
+        if (target==4){ // CPU, CholeskyQR2 / shifted CholeskyQR3:
+            printf("CGS-RO (TARGET=MULTICORE, CHOLQR):\n"); 
+            
+            cgsro_cholqr ( A_1d, Qmulticore_1d, s, m, n, timer_acc );
+  
+            if (performOrthogonalityTest ==1)
+                othogonalityTest(Qmulticore_1d, m, n, s );
+        }
+        if (target==5){ // CPU, randomized Gram-Schmidt:
+            printf("CGS-RO (TARGET=MULTICORE, RGS):\n"); 
+            
+            if (S_1d == NULL)
+                S_1d = (T*)mallocChecked(rgs_sketch_size, n, 1, sizeof(T));
+
+            cgsro_rgs ( A_1d, Qmulticore_1d, S_1d, rgs_sketch_type, rgs_sketch_size, s, m, n, timer_acc );
+  
+            if (performOrthogonalityTest ==1){
+                printf("[RGS] sketched loss of orthogonality (Theta*Q):\n"); 
+                othogonalityTest(S_1d, rgs_sketch_size, n, s );
+                printf("[RGS] true loss of orthogonality (Q):\n"); 
+                othogonalityTest(Qmulticore_1d, m, n, s );
+            }
+        }
+        if (target==6){ // CPU, mixed precision:
+            printf("CGS-RO (TARGET=MULTICORE, MIXED PRECISION):\n"); 
+            
+            cgsro_mixed ( A_1d, Qmulticore_1d, mixed_storage, s, m, n, timer_acc );
+  
+            if (performOrthogonalityTest ==1)
+                othogonalityTest(Qmulticore_1d, m, n, s );
+
+            if (mixed_refine == 1){
+                cgsro_refine ( Qmulticore_1d, s, m, n, timer_acc );
+
+                if (performOrthogonalityTest ==1)
+                    othogonalityTest(Qmulticore_1d, m, n, s );
+            }
+        }
+        if (target==7){ // CPU, complex:
+            printf("CGS-RO (TARGET=MULTICORE, COMPLEX):\n"); 
+
+            cgsro_complex ( Ac_1d, Qc_1d, s, m, n, timer_acc );
+  
+            if (performOrthogonalityTest ==1)
+                othogonalityTestComplex(Qc_1d, m, n, s );
+
+            if (compareRealEmbedding == 1){
+                printf("CGS-RO (TARGET=MULTICORE, 2x REAL EMBEDDING %lld x %lld):\n", 2*m, 2*n); 
+
+                cgsro_multicore ( Aemb_1d, Qemb_1d, s, 2*m, 2*n, timer_emb );
+
+                if (performOrthogonalityTest ==1)
+                    othogonalityTest(Qemb_1d, 2*m, 2*n, s );
+            }
+        }
+        if (target==8){ // CPU, distributed (row-blocks):
+            printf("CGS-RO (TARGET=DISTRIBUTED):\n"); 
+            
+            cgsro_distributed ( A_1d, Qmulticore_1d, dist_procs, s, m, n, timer_acc );
   
             if (performOrthogonalityTest ==1)
                 othogonalityTest(Qmulticore_1d, m, n, s );
@@ -142,12 +398,8 @@ void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
         
             // it is reqiuired since v_1d is updated in GPU modification and 
             // for new setup (ro_steps) v_1d must be a copy of A      
-            for(int j = 0; j < n; j++){
-                for(int i = 0; i < m; i++){
-                    Qgpu_1d[i + j*m] = A[i][j];
-                    v_1d[i+j*m] = A[i][j];
-                }
-            }
+            memcpy( Qgpu_1d, A_1d, m*n*sizeof(T));
+            memcpy( v_1d, A_1d, m*n*sizeof(T));
             
             cgsro_gpu  ( Qgpu_1d, v_1d, s, m, n, timer_acc );
 
@@ -156,17 +408,47 @@ void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
                 othogonalityTest(Qgpu_1d, m, n, s );
 
         }
+
+        // Q of the parallel run against the reference Q (not for complex Q)
+        if (useRefCache == 1 && ref[s-1].map != NULL && target != 7 && perm == NULL && aborted[s-1] < 0){
+            T * Qpar = (target == 2) ? Qgpu_1d : Qmulticore_1d;
+            double t_diff = mclock();
+            double diff = maxDiff( Qpar, (T*)ref[s-1].Q, m*n);
+            t_diff = mclock() - t_diff;
+            printf("[REF CACHE][re-ortho #%d] max|Q - Q_ref| = %1.3e [TIME: %1.3f s]\n", s, diff, t_diff);
+        }
         
     }
 
     for (int s = 1; s <= ro_steps; s++){    
-        printf("Speedup [CGS-RO][# re-orthogonalizations = %2d] = %1.2f \n", s, timer_seq[s-1][8]/timer_acc[s-1][8] );
+        if (aborted[s-1] >= 0)
+            printf("Speedup [CGS-RO][# re-orthogonalizations = %2d] = --- (run aborted after %lld of %lld columns)\n", s, aborted[s-1], n );
+        else
+            printf("Speedup [CGS-RO][# re-orthogonalizations = %2d] = %1.2f \n", s, timer_seq[s-1][8]/timer_acc[s-1][8] );
+    }
+
+    if (target == 1 && compareProjectionBackends == 1){
+        for (int s = 1; s <= ro_steps; s++){    
+            if (aborted[s-1] < 0)
+                printf("Speedup [CGS-RO][# re-orthogonalizations = %2d][projection: CBLAS vs native] = %1.2f \n", s, timer_acc[s-1][4]/timer_blas[s-1][4] );
+        }
+    }
+
+    if (target == 7 && compareRealEmbedding == 1){
+        for (int s = 1; s <= ro_steps; s++){    
+            printf("Speedup [CGS-RO][# re-orthogonalizations = %2d][complex vs 2x real embedding] = %1.2f \n", s, timer_emb[s-1][8]/timer_acc[s-1][8] );
+        }
     }
 
     printf("\n[-------------------]\n");
-    printf("A [%d x %d] \n", m, n); 
+    printf("A [%lld x %lld] \n", m, n); 
     printf("[-------------------]\n");
-    for (int s = 0; s < ro_steps; s++){
+    // phases of TSQR, CholeskyQR, RGS, mixed-precision, complex and distributed CGS-RO are different than phases of CGS-RO, only the total time is compared
+    int speedup_steps = (target >= 3) ? 0 : ro_steps;
+
+    for (int s = 0; s < speedup_steps; s++){
+        if (aborted[s] >= 0)
+            continue;
         printf("[SPEEDUP][No. of re-orthogonalizations: %2d]\n", s);
         printf("[CGS-RO] 1. init       = %1.1f  \n",    timer_seq[s][0]/timer_acc[s][0]);
         printf("[CGS-RO] 2. aj         = %1.1f  \n",    timer_seq[s][1]/timer_acc[s][1]);
@@ -185,7 +467,27 @@ void run_cgsro( int m, int n, int ro_steps, int target, double ** A){
     }
 
 
+    for (int s = 1; s <= ro_steps; s++)
+        refCacheRelease( &ref[s-1] );
+
+    arenaReport();
+    delete [] ref;
+    delete [] aborted;
+    free( perm );
+    if (A_csc != NULL)
+        cscFree( A_csc );
+
     delete [] A ;
 
 }
 
+// precision: 1 - float, 2 - double, 3 - long double
+void run_cgsro( long long m, long long n, int ro_steps, int target, int precision, double ** A){
+
+    if (precision == 1)
+        run_cgsro_scalar<float>       ( m, n, ro_steps, target, A);
+    else if (precision == 3)
+        run_cgsro_scalar<long double> ( m, n, ro_steps, target, A);
+    else
+        run_cgsro_scalar<double>      ( m, n, ro_steps, target, A);
+}
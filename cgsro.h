@@ -1 +1 @@
-void run_cgsro( int m, int n, int steps, int target, double ** A) ;
+void run_cgsro( long long m, long long n, int steps, int target, int precision, double ** A) ;
@@ -0,0 +1,135 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_blas.cpp : projection step (r = Q^T*v, v = v - Q*r) routed either through native loops or through a CBLAS library selected at build time
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Build-time selection of the BLAS library (see compile.sh):
+//  -DCGSRO_CBLAS            : any CBLAS implementation (OpenBLAS, BLIS, ATLAS, ...), link e.g. with -lopenblas or -lblis
+//  -DCGSRO_CBLAS -DCGSRO_MKL : Intel MKL, link with -lmkl_rt
+// Without CGSRO_CBLAS only the native path is compiled and the CBLAS backend cannot be selected.
+
+#include "helpers.h"
+#include "cgsro_blas.h"
+#include "limits.h"
+
+#ifdef CGSRO_CBLAS
+#ifdef CGSRO_MKL
+#include "mkl_cblas.h"
+#else
+#include "cblas.h"
+#endif
+#endif
+
+// 0 - native loops, 1 - CBLAS
+static int projection_backend = 0;
+
+int cblasAvailable(){
+#ifdef CGSRO_CBLAS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void setProjectionBackend( int backend ){
+    if (backend == 1 && !cblasAvailable()){
+        printf("[CGS-RO] CBLAS backend requested, but code was compiled without -DCGSRO_CBLAS: native loops are used\n");
+        backend = 0;
+    }
+    projection_backend = backend;
+}
+
+int getProjectionBackend(){
+    return projection_backend;
+}
+
+const char * projectionBackendName(){
+    if (projection_backend == 1){
+#ifdef CGSRO_MKL
+        return "CBLAS (MKL)";
+#else
+        return "CBLAS";
+#endif
+    }
+    return "native";
+}
+
+#ifdef CGSRO_CBLAS
+// r = Q^T*v_in, v_out = v_out - Q*r with xGEMV of a given precision; returns 0 if there is no such routine in CBLAS
+int cblasProjection( float * Q_1d, float * v_in, float * v_out, float * r, long long m, long long j){
+    cblas_sgemv(CblasColMajor, CblasTrans,   m, j,  1.0f, Q_1d, m, v_in, 1, 0.0f, r,     1);
+    cblas_sgemv(CblasColMajor, CblasNoTrans, m, j, -1.0f, Q_1d, m, r,    1, 1.0f, v_out, 1);
+    return 1;
+}
+
+int cblasProjection( double * Q_1d, double * v_in, double * v_out, double * r, long long m, long long j){
+    cblas_dgemv(CblasColMajor, CblasTrans,   m, j,  1.0, Q_1d, m, v_in, 1, 0.0, r,     1);
+    cblas_dgemv(CblasColMajor, CblasNoTrans, m, j, -1.0, Q_1d, m, r,    1, 1.0, v_out, 1);
+    return 1;
+}
+
+int cblasProjection( long double * Q_1d, long double * v_in, long double * v_out, long double * r, long long m, long long j){
+    return 0;
+}
+#endif
+
+// Classical Gram-Schmidt projection of v_in against first j columns of Q (GEMV pair):
+//   r     = Q(:,0:j-1)^T * v_in
+//   v_out = v_out - Q(:,0:j-1) * r
+// v_out is expected to be a copy of v_in (see updatev_1d), r must hold at least j entries.
+template <typename T>
+void projection_gemv( T * Q_1d, T * v_in, T * v_out, T * r, long long m, long long j){
+
+    if (j == 0)
+        return;
+
+#ifdef CGSRO_CBLAS
+    // CBLAS (LP64) takes int dimensions: larger problems (and long double) fall back to the native loops
+    if (projection_backend == 1 && m <= INT_MAX && cblasProjection( Q_1d, v_in, v_out, r, m, j))
+        return;
+#endif
+
+    for (long long i = 0; i < j; i++){
+        T tmp1 = 0.0;
+        for (long long row = 0; row < m; row++)
+            tmp1 += Q_1d[row + i*m] * v_in[row];
+        r[i] = tmp1;
+    }
+
+    for (long long i = 0; i < j; i++){
+        for (long long row = 0; row < m; row++)
+            v_out[row] -= r[i]*Q_1d[row + i*m];
+    }
+}
+
+template void projection_gemv( float * Q_1d, float * v_in, float * v_out, float * r, long long m, long long j);
+template void projection_gemv( double * Q_1d, double * v_in, double * v_out, double * r, long long m, long long j);
+template void projection_gemv( long double * Q_1d, long double * v_in, long double * v_out, long double * r, long long m, long long j);
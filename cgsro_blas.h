@@ -0,0 +1,6 @@
+int  cblasAvailable();
+void setProjectionBackend( int backend );
+int  getProjectionBackend();
+const char * projectionBackendName();
+template <typename T>
+void projection_gemv( T * Q_1d, T * v_in, T * v_out, T * r, long long m, long long j);
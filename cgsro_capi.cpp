@@ -0,0 +1,175 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_capi.cpp : the C interface of libparallelcgs.so (LAPACK-style: leading dimensions, in place, workspace query)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// CGS-RO on strided columns: the column j of A is copied to the workspace v, ro_steps passes of
+// r = Q(:,0:j-1)^T*v, v = v - Q(:,0:j-1)*r are done and v/||v|| is stored in the column j of Q.
+// Only the columns 0..j-1 of Q are read while the column j is computed and the column j of A is read
+// before the column j of Q is written, so Q may overwrite A. The workspace is v (m) and r (n).
+
+#include "helpers.h"
+#include "parallelcgs.h"
+
+#include <limits>
+
+template <typename T>
+long long gsqrfWork( long long m, long long n ){
+    return m + n;
+}
+
+template <typename T>
+int gsqrf( long long m, long long n, const T * A, long long lda, T * Q, long long ldq,
+           T * R, long long ldr, int ro_steps, T * work, long long lwork ){
+
+    if (lwork == -1){
+        if (work == NULL)
+            return -10;
+        work[0] = (T)gsqrfWork<T>( m, n);
+        return 0;
+    }
+    if (m < 0)                          return -1;
+    if (n < 0 || n > m)                 return -2;
+    if (A == NULL)                      return -3;
+    if (lda < (m > 1 ? m : 1))          return -4;
+    if (Q == NULL)                      return -5;
+    if (ldq < (m > 1 ? m : 1))          return -6;
+    if (R == NULL)                      return -7;
+    if (ldr < (n > 1 ? n : 1))          return -8;
+    if (ro_steps < 1)                   return -9;
+    if (work != NULL && lwork < gsqrfWork<T>( m, n))
+        return -11;
+    if ((const T*)Q == A && ldq != lda) return -6;
+
+    ArenaMark mark = arenaMark();
+    if (work == NULL)
+        work = (T*)arenaAlloc( gsqrfWork<T>( m, n), 1, 1, sizeof(T));
+    T * v = work;
+    T * r = work + m;
+
+    typedef typename Accumulator<T>::type Acc;  // float sums in double
+    int info = 0;
+    for (long long j = 0; j < n; j++){
+
+        Acc norma = 0.0;
+        #pragma acc parallel loop reduction(+:norma)
+        for (long long row = 0; row < m; row++){
+            v[row] = A[row + j*lda];
+            norma += (Acc)v[row] * v[row];
+        }
+
+        for (long long i = 0; i < n; i++)
+            R[i + j*ldr] = 0.0;
+
+        for (int pass = 0; pass < ro_steps; pass++){
+            #pragma acc parallel loop
+            for (long long i = 0; i < j; i++){
+                Acc tmp1 = 0.0;
+                for (long long row = 0; row < m; row++)
+                    tmp1 += (Acc)Q[row + i*ldq] * v[row];
+                r[i] = (T)tmp1;
+            }
+            #pragma acc parallel loop
+            for (long long row = 0; row < m; row++){
+                Acc tmp1 = v[row];
+                for (long long i = 0; i < j; i++)
+                    tmp1 -= (Acc)Q[row + i*ldq] * r[i];
+                v[row] = (T)tmp1;
+            }
+            for (long long i = 0; i < j; i++)
+                R[i + j*ldr] += r[i];
+        }
+
+        Acc tmp = 0.0;
+        #pragma acc parallel loop reduction(+:tmp)
+        for (long long row = 0; row < m; row++)
+            tmp += (Acc)v[row] * v[row];
+        T norm = (T)sqrt(tmp);
+        R[j + j*ldr] = norm;
+
+        // nothing but rounding errors is left of the column
+        if (info == 0 && (double)norm <= 100.0 * std::numeric_limits<T>::epsilon() * sqrt((double)norma))
+            info = (int)(j + 1);
+        if (norm == 0.0)
+            norm = 1.0;
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            Q[row + j*ldq] = v[row] / norm;
+    }
+
+    arenaRelease( mark );
+    return info;
+}
+
+// max |entry| of I - Q^T*Q summed in T as orthogonalityNorm (helpers.cpp), so C, Python and the driver agree
+template <typename T>
+double orthogonality( long long m, long long n, const T * Q, long long ldq ){
+    double norm = 0.0;
+    #pragma acc parallel loop collapse(2) reduction(max:norm)
+    for (long long i = 0; i < n; i++){
+        for (long long j = 0; j < n; j++){
+            T tmp = 0.0;
+            for (long long k = 0; k < m; k++)
+                tmp += Q[k + i*ldq] * Q[k + j*ldq];
+            T e = (T)(i == j ? 1.0 : 0.0) - tmp;
+            double a = (double)(e < 0 ? -e : e);
+            if (a > norm)
+                norm = a;
+        }
+    }
+    return norm;
+}
+
+extern "C" {
+
+int pcgs_version( void ){
+    return PCGS_VERSION;
+}
+
+int pcgs_dgsqrf( long long m, long long n, const double * A, long long lda, double * Q, long long ldq,
+                 double * R, long long ldr, int ro_steps, double * work, long long lwork ){
+    return gsqrf( m, n, A, lda, Q, ldq, R, ldr, ro_steps, work, lwork);
+}
+
+int pcgs_sgsqrf( long long m, long long n, const float * A, long long lda, float * Q, long long ldq,
+                 float * R, long long ldr, int ro_steps, float * work, long long lwork ){
+    return gsqrf( m, n, A, lda, Q, ldq, R, ldr, ro_steps, work, lwork);
+}
+
+double pcgs_dorthogonality( long long m, long long n, const double * Q, long long ldq ){
+    return orthogonality( m, n, Q, ldq);
+}
+
+double pcgs_sorthogonality( long long m, long long n, const float * Q, long long ldq ){
+    return orthogonality( m, n, Q, ldq);
+}
+
+}
@@ -0,0 +1,233 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_checkpoint.cpp : checkpoint/restart of the column loop (finished columns of Q in a mapped file, written back by a background thread)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// A column of Q is final once the column loop of an engine has passed it, and the next columns depend only on A
+// and the finished ones. An engine with checkpointing enabled (setCheckpoint) therefore:
+//   j0 = ckptBegin(...)   - maps <dir>/<engine>_<key>.ckpt; if it holds columns of the same A, m, n, s and T
+//                           they are copied to Q and the loop starts at j0 (0 otherwise);
+//                           ckptOpen(...) does the same for Q stored in another type than A (key given by the caller)
+//   ckptColumn(j+1)       - after the column j; at most every period seconds the new columns are copied to the map
+//                           and handed to the writer thread, which msyncs them and only then advances done in the header
+//   ckptEnd(done)         - flushes the writer; removes the file if all n columns are done, otherwise (the loop was
+//                           stopped, e.g. by the overlapped verifier) keeps exactly columns 0..done-1 in it
+// The compute threads never wait for the disk: they copy columns into the page cache and signal the writer.
+// A restarted run (same setup, e.g. after preemption) resumes at the last column the writer has committed.
+
+#include "helpers.h"
+#include "cgsro_checkpoint.h"
+#include "cgsro_refcache.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "pthread.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+// active checkpoint of the running engine
+struct Checkpoint {
+    char path[4096+64];
+    CkptHeader * h;
+    char * data;                // Q in the file
+    char * Q;                   // Q of the engine
+    long long bytes, colbytes;
+    long long staged;           // columns copied to the map
+    long long committed;        // columns on disk (header updated)
+    double last;
+    int stop;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static char ckpt_dir[4096] = "";
+static double ckpt_period = 10.0;
+static Checkpoint * ckpt = NULL;
+
+void setCheckpoint( const char * dir, double period ){
+    snprintf( ckpt_dir, sizeof(ckpt_dir), "%s", dir != NULL ? dir : "");
+    ckpt_period = period;
+    if (ckpt_dir[0] != '\0')
+        mkdir( ckpt_dir, 0755);
+}
+
+int checkpointEnabled(){
+    return ckpt_dir[0] != '\0';
+}
+
+static void * ckptWriter( void * arg ){
+    Checkpoint * c = (Checkpoint*)arg;
+    long long page = sysconf( _SC_PAGESIZE );
+    while (1){
+        pthread_mutex_lock( &c->lock );
+        while (!c->stop && c->staged == c->committed)
+            pthread_cond_wait( &c->cond, &c->lock );
+        long long from = c->committed, to = c->staged;
+        int stop = c->stop;
+        pthread_mutex_unlock( &c->lock );
+        if (from == to && stop)
+            break;
+
+        // columns first, then the header which publishes them
+        long long off0 = CKPT_HEADER_BYTES + from * c->colbytes;
+        long long off1 = CKPT_HEADER_BYTES + to * c->colbytes;
+        off0 = off0 / page * page;
+        msync( (char*)c->h + off0, off1 - off0, MS_SYNC);
+        c->h->done = to;
+        msync( c->h, page, MS_SYNC);
+
+        pthread_mutex_lock( &c->lock );
+        c->committed = to;
+        pthread_mutex_unlock( &c->lock );
+    }
+    return NULL;
+}
+
+// Q has m x n entries of size bytes (its storage type may differ from A, e.g. in the mixed-precision engine)
+long long ckptOpen( const char * engine, unsigned long long key, void * Q_1d, long long size, long long m, long long n, int s ){
+    if (!checkpointEnabled() || ckpt != NULL)
+        return 0;
+
+    Checkpoint * c = new Checkpoint;
+    snprintf( c->path, sizeof(c->path), "%s/%s_%016llx.ckpt", ckpt_dir, engine, key);
+    c->colbytes = m * size;
+    c->bytes = CKPT_HEADER_BYTES + n * c->colbytes;
+
+    int fd = open( c->path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (fd < 0 || fstat( fd, &st) != 0 || (st.st_size != c->bytes && ftruncate( fd, c->bytes) != 0)){
+        printf("[CHECKPOINT] cannot create %s: no checkpoints\n", c->path);
+        if (fd >= 0)
+            close( fd );
+        delete c;
+        return 0;
+    }
+    void * p = mmap( NULL, c->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close( fd );
+    if (p == MAP_FAILED){
+        delete c;
+        return 0;
+    }
+    c->h = (CkptHeader*)p;
+    c->data = (char*)p + CKPT_HEADER_BYTES;
+    c->Q = (char*)Q_1d;
+
+    // a file of another setup (or an empty one) starts from column 0
+    CkptHeader * h = c->h;
+    long long j0 = 0;
+    if (memcmp( h->magic, "CGSROCKP", 8) == 0 && h->key == key && h->m == m && h->n == n && h->s == s 
+        && h->size == size && h->done > 0 && h->done <= n){
+        j0 = h->done;
+        memcpy( Q_1d, c->data, j0 * c->colbytes);
+        printf("[CHECKPOINT] %s: resumed at column %lld of %lld\n", c->path, j0, n);
+    }
+    else {
+        memcpy( h->magic, "CGSROCKP", 8);
+        h->key = key;
+        h->m = m;
+        h->n = n;
+        h->s = s;
+        h->size = size;
+        h->done = 0;
+    }
+
+    c->staged = c->committed = j0;
+    c->last = mclock();
+    c->stop = 0;
+    pthread_mutex_init( &c->lock, NULL);
+    pthread_cond_init( &c->cond, NULL);
+    pthread_create( &c->writer, NULL, ckptWriter, c);
+    ckpt = c;
+    return j0;
+}
+
+template <typename T>
+long long ckptBegin( const char * engine, T * A_1d, T * Q_1d, long long m, long long n, int s ){
+    if (!checkpointEnabled() || ckpt != NULL)
+        return 0;
+    return ckptOpen( engine, refCacheKey( A_1d, m, n, s), Q_1d, sizeof(T), m, n, s);
+}
+
+void ckptColumn( long long done ){
+    Checkpoint * c = ckpt;
+    if (c == NULL || mclock() - c->last < ckpt_period)
+        return;
+
+    // the writer may still sync older columns, new ones go to other pages of the map
+    memcpy( c->data + c->staged * c->colbytes, c->Q + c->staged * c->colbytes, (done - c->staged) * c->colbytes);
+    pthread_mutex_lock( &c->lock );
+    c->staged = done;
+    pthread_cond_signal( &c->cond );
+    pthread_mutex_unlock( &c->lock );
+    c->last = mclock();
+}
+
+void ckptEnd( long long done ){
+    Checkpoint * c = ckpt;
+    if (c == NULL)
+        return;
+
+    long long n = c->h->n;
+    int complete = (done == n);
+    if (!complete && done > c->staged)
+        memcpy( c->data + c->staged * c->colbytes, c->Q + c->staged * c->colbytes, (done - c->staged) * c->colbytes);
+
+    pthread_mutex_lock( &c->lock );
+    if (!complete && done > c->staged)
+        c->staged = done;
+    c->stop = 1;
+    pthread_cond_signal( &c->cond );
+    pthread_mutex_unlock( &c->lock );
+    pthread_join( c->writer, NULL);
+
+    // columns the caller does not trust (e.g. failed the overlapped orthogonality test) may already be on disk
+    if (!complete && done > 0 && c->h->done > done){
+        c->h->done = done;
+        msync( c->h, sysconf( _SC_PAGESIZE ), MS_SYNC);
+    }
+
+    // the checkpoint is not needed any more once the factorization is complete (or if nothing of it can be used)
+    munmap( c->h, c->bytes);
+    if (complete || done <= 0)
+        unlink( c->path );
+    else
+        printf("[CHECKPOINT] %s: stopped, columns 0..%lld of %lld are kept\n", c->path, done-1, n);
+    pthread_mutex_destroy( &c->lock );
+    pthread_cond_destroy( &c->cond );
+    delete c;
+    ckpt = NULL;
+}
+
+template long long ckptBegin( const char * engine, float * A_1d, float * Q_1d, long long m, long long n, int s );
+template long long ckptBegin( const char * engine, double * A_1d, double * Q_1d, long long m, long long n, int s );
+template long long ckptBegin( const char * engine, long double * A_1d, long double * Q_1d, long long m, long long n, int s );
@@ -0,0 +1,50 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_checkpoint.h : checkpoint/restart of the column loop (finished columns of Q in a mapped file, written back by a background thread)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+#define CKPT_HEADER_BYTES 4096  // Q starts on a page boundary
+
+// header of a checkpoint file (followed by the columns of Q)
+struct CkptHeader {
+    char magic[8];              // "CGSROCKP"
+    unsigned long long key;     // refCacheKey of (A, m, n, s, sizeof(T))
+    long long m, n, s, size;
+    long long done;             // columns 0..done-1 of Q are on disk
+};
+
+void setCheckpoint( const char * dir, double period );
+int  checkpointEnabled();
+long long ckptOpen( const char * engine, unsigned long long key, void * Q_1d, long long size, long long m, long long n, int s );
+template <typename T>
+long long ckptBegin( const char * engine, T * A_1d, T * Q_1d, long long m, long long n, int s );
+void ckptColumn( long long done );
+void ckptEnd( long long done );
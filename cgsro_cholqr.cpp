@@ -0,0 +1,260 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_cholqr.cpp : this function incudes CholeskyQR2 and shifted CholeskyQR3 for tall-skinny matrices on a CPU (OpenACC multicore) with a fallback to CGS-RO
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// One pass of CholeskyQR:  G = Q^T*Q,  G = R^T*R (Cholesky),  Q = Q*R^-1.
+// CholeskyQR2 repeats it twice (second pass restores orthogonality lost in the first one).
+// If Cholesky of the first Gram matrix breaks down (A ill-conditioned) then the first pass is done for G + shift*I 
+// (shifted CholeskyQR3: Fukaya, Kannan, Nakatsukasa, Yamamoto, Yanagisawa, 2020) and followed by CholeskyQR2.
+// If Cholesky breaks down again CGS-RO (cgsro_multicore) is performed instead.
+
+#include "helpers.h"
+#include "cgsro_cholqr.h"
+#include "cgsro_multicore.h"
+#include <limits>
+
+// rows per block in Gram matrix calculation (Q(block,:) stays in cache while G is updated)
+#define CHOLQR_BLOCK 4096
+
+// G (n x n) = Q^T*Q, only one pass over Q; partial Gram matrices of row-blocks are summed afterwards
+template <typename T>
+void gramMatrix( T * Q_1d, T * G, T * Gpart, long long m, long long n){
+
+    long long nblocks = (m + CHOLQR_BLOCK - 1)/CHOLQR_BLOCK;
+    long long nn = n*n;
+
+    #pragma acc parallel loop gang
+    for (long long b = 0; b < nblocks; b++){
+        long long row0 = b*CHOLQR_BLOCK;
+        long long row1 = (row0 + CHOLQR_BLOCK < m) ? row0 + CHOLQR_BLOCK : m;
+        for (long long j = 0; j < n; j++){
+            for (long long i = 0; i <= j; i++){
+                T tmp = 0.0;
+                for (long long row = row0; row < row1; row++)
+                    tmp += Q_1d[row + i*m] * Q_1d[row + j*m];
+                Gpart[b*nn + i + j*n] = tmp;
+            }
+        }
+    }
+
+    #pragma acc parallel loop
+    for (long long j = 0; j < n; j++){
+        for (long long i = 0; i <= j; i++){
+            T tmp = 0.0;
+            for (long long b = 0; b < nblocks; b++)
+                tmp += Gpart[b*nn + i + j*n];
+            G[i + j*n] = tmp;
+            G[j + i*n] = tmp;
+        }
+    }
+}
+
+// Cholesky G = R^T*R, R upper triangular overwrites upper part of G. Returns 0 or a column for which it breaks down (+1).
+template <typename T>
+int choleskyUpper( T * G, long long n){
+    for (long long j = 0; j < n; j++){
+        for (long long i = 0; i < j; i++){
+            T tmp = G[i + j*n];
+            for (long long k = 0; k < i; k++)
+                tmp -= G[k + i*n] * G[k + j*n];
+            G[i + j*n] = tmp / G[i + i*n];
+        }
+        T d = G[j + j*n];
+        for (long long k = 0; k < j; k++)
+            d -= G[k + j*n] * G[k + j*n];
+        if (!(d > 0.0))
+            return j+1;
+        G[j + j*n] = sqrt(d);
+    }
+    return 0;
+}
+
+// Q = Q*R^-1 (R upper triangular), rows are independent
+template <typename T>
+void triangularSolveRight( T * Q_1d, T * R, long long m, long long n){
+    #pragma acc parallel loop
+    for (long long row = 0; row < m; row++){
+        for (long long c = 0; c < n; c++){
+            T tmp = Q_1d[row + c*m];
+            for (long long l = 0; l < c; l++)
+                tmp -= Q_1d[row + l*m] * R[l + c*n];
+            Q_1d[row + c*m] = tmp / R[c + c*n];
+        }
+    }
+}
+
+// single pass of (shifted) CholeskyQR, returns result of choleskyUpper
+template <typename T>
+int cholqrPass( T * Q_1d, T * G, T * Gpart, long long m, long long n, double shift, double * timer){
+
+    double timer_tmp = mclock();
+    gramMatrix( Q_1d, G, Gpart, m, n);
+    if (shift > 0.0){
+        for (long long j = 0; j < n; j++)
+            G[j + j*n] += shift;
+    }
+    timer[3] += mclock() - timer_tmp;
+
+    timer_tmp = mclock();
+    int info = choleskyUpper( G, n);
+    timer[4] += mclock() - timer_tmp;
+
+    if (info != 0)
+        return info;
+
+    timer_tmp = mclock();
+    triangularSolveRight( Q_1d, G, m, n);
+    timer[5] += mclock() - timer_tmp;
+
+    return 0;
+}
+
+// R = Rp*R for the upper triangular factor Rp (upper part of G) of the last pass, R = Rp after the first one
+template <typename T>
+void cholqrAccumulateR( T * R_1d, T * G, T * W, long long n, int first){
+    #pragma acc parallel loop collapse(2)
+    for (long long j = 0; j < n; j++){
+        for (long long i = 0; i < n; i++){
+            T tmp = 0.0;
+            if (first)
+                tmp = (i <= j) ? G[i + j*n] : 0.0;
+            else{
+                for (long long k = i; k <= j; k++)
+                    tmp += G[i + k*n] * R_1d[k + j*n];
+            }
+            W[i + j*n] = tmp;
+        }
+    }
+    #pragma acc parallel loop
+    for (long long idx = 0; idx < n*n; idx++)
+        R_1d[idx] = W[idx];
+}
+
+// returns number of CholeskyQR passes (2 - CholeskyQR2, 3 - shifted CholeskyQR3) or 0 if CGS-RO was used;
+// if R_1d != NULL the product of the Cholesky factors of all passes (A = Q*R) is stored there
+template <typename T>
+int cgsro_cholqr( T * A_1d, T * Q_1d, int ro_steps, long long m, long long n, double ** timer, T * R_1d){
+
+    double timer_tmp;
+    for(int ii = 0; ii < 9; ii++){
+        timer[ro_steps-1][ii] = 0.0;
+    }
+
+    double time_cgs = mclock();
+    timer_tmp = mclock();
+
+    long long nblocks = (m + CHOLQR_BLOCK - 1)/CHOLQR_BLOCK;
+    ArenaMark mark = arenaMark();
+    T * G     = (T*)arenaAlloc(n, n, 1, sizeof(T));
+    T * Gpart = (T*)arenaAlloc(n, n, nblocks, sizeof(T));
+    T * W     = (R_1d != NULL) ? (T*)arenaAlloc(n, n, 1, sizeof(T)) : NULL;
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < m; row++)
+        for (long long j = 0; j < n; j++)
+            Q_1d[row + j*m] = A_1d[row + j*m];
+
+    timer[ro_steps-1][0] += mclock() - timer_tmp;
+
+    int passes = 2;
+    int info = cholqrPass( Q_1d, G, Gpart, m, n, 0.0, timer[ro_steps-1]);
+    if (info == 0 && R_1d != NULL)
+        cholqrAccumulateR( R_1d, G, W, n, 1);
+
+    if (info != 0){
+        // shift = 11*(m*n + n*(n+1))*u*||A||_F^2 (u - unit roundoff of T)
+        printf("[CHOLQR] Cholesky breakdown at column %d: shifted CholeskyQR3 is performed\n", info-1);
+
+        timer_tmp = mclock();
+        T normF2 = 0.0;
+        if (getReproducibleReductions()){
+            for (long long j = 0; j < n; j++)
+                normF2 += reproDot( &A_1d[j*m], &A_1d[j*m], m);
+        }
+        else
+        {
+            #pragma acc parallel loop reduction(+:normF2)
+            for (long long row = 0; row < m; row++)
+                for (long long j = 0; j < n; j++)
+                    normF2 += A_1d[row + j*m] * A_1d[row + j*m];
+        }
+        double shift = 11.0*((double)m*n + (double)n*(n+1))*(std::numeric_limits<T>::epsilon()/2)*normF2;
+
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            for (long long j = 0; j < n; j++)
+                Q_1d[row + j*m] = A_1d[row + j*m];
+        timer[ro_steps-1][0] += mclock() - timer_tmp;
+
+        passes = 3;
+        info = cholqrPass( Q_1d, G, Gpart, m, n, shift, timer[ro_steps-1]);
+        if (info == 0 && R_1d != NULL)
+            cholqrAccumulateR( R_1d, G, W, n, 1);
+    }
+
+    // remaining passes: CholeskyQR2 after the shifted pass, second pass of CholeskyQR2 otherwise
+    for (int p = (passes == 2) ? 1 : 0; p < 2 && info == 0; p++){
+        info = cholqrPass( Q_1d, G, Gpart, m, n, 0.0, timer[ro_steps-1]);
+        if (info == 0 && R_1d != NULL)
+            cholqrAccumulateR( R_1d, G, W, n, 0);
+    }
+
+    arenaRelease(mark);
+
+    if (info != 0){
+        printf("[CHOLQR] Cholesky breakdown at column %d: CGS-RO is performed instead\n", info-1);
+        cgsro_multicore( A_1d, Q_1d, ro_steps, m, n, timer, (CscMatrix<T>*)NULL, NULL, 1e-10, R_1d);
+        return 0;
+    }
+
+    time_cgs = mclock() - time_cgs;
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 7; ii++){
+        time_loop += timer[ro_steps-1][ii];
+    }
+    timer[ro_steps-1][8] = time_loop;
+
+    printf("[CHOLQR] %s\n", passes == 2 ? "CholeskyQR2" : "shifted CholeskyQR3");
+    printf("[CHOLQR] PHASE               sec. [ %% ] \n"  );
+    printf("[CHOLQR] 1. init          = %1.3f [%3.1f ] \n", timer[ro_steps-1][0], 100.0*timer[ro_steps-1][0] / time_cgs );
+    printf("[CHOLQR] 2. Q^T*Q         = %1.3f [%3.1f ] \n", timer[ro_steps-1][3], 100.0*timer[ro_steps-1][3] / time_cgs );
+    printf("[CHOLQR] 3. Cholesky      = %1.3f [%3.1f ] \n", timer[ro_steps-1][4], 100.0*timer[ro_steps-1][4] / time_cgs );
+    printf("[CHOLQR] 4. Q*R^-1        = %1.3f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs );
+    printf("[CHOLQR] 1-4 CHOLQR       = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs );
+
+    return passes;
+}
+
+template int cgsro_cholqr( float * A_1d, float * Q_1d, int ro_steps, long long m, long long n, double ** timer, float * R_1d);
+template int cgsro_cholqr( double * A_1d, double * Q_1d, int ro_steps, long long m, long long n, double ** timer, double * R_1d);
+template int cgsro_cholqr( long double * A_1d, long double * Q_1d, int ro_steps, long long m, long long n, double ** timer, long double * R_1d);
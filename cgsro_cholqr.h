@@ -0,0 +1,12 @@
+template <typename T>
+void gramMatrix( T * Q_1d, T * G, T * Gpart, long long m, long long n);
+template <typename T>
+int  choleskyUpper( T * G, long long n);
+template <typename T>
+void triangularSolveRight( T * Q_1d, T * R, long long m, long long n);
+template <typename T>
+int  cholqrPass( T * Q_1d, T * G, T * Gpart, long long m, long long n, double shift, double * timer);
+template <typename T>
+void cholqrAccumulateR( T * R_1d, T * G, T * W, long long n, int first);
+template <typename T>
+int  cgsro_cholqr( T * A_1d, T * Q_1d, int ro_steps, long long m, long long n, double ** timer, T * R_1d = NULL);
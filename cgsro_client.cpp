@@ -0,0 +1,178 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_client.cpp : a small client of the job server (cgsro_server.cpp): writes test matrices and sends requests
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// usage:
+//   ./cgsro_client gen <path> <m> <n> [family [cond [seed]]]   - writes a test matrix (raw column-major doubles)
+//   ./cgsro_client <socket> <request> [<request> ...]          - sends the requests at once, prints one reply per request
+//   ./cgsro_client shm /name <m> <n> <ro_steps> <target> [jobs [inplace [verify [family [cond [seed]]]]]]
+//                                                              - producer of a shared-memory region (./cgsro --attach /name):
+//                                                                writes A into the region, hands over jobs and closes it
+//   ./cgsro_client monitor /name [period]                      - prints the telemetry page of a running solver
+// e.g.
+//   ./cgsro_client /tmp/cgsro.sock "QR /tmp/A.bin 100000 100 2 1" "QR /tmp/A.bin 100000 100 1 4 verify" STATS
+
+#include "helpers.h"
+#include "cgsro_generator.h"
+#include "cgsro_shm.h"
+#include "cgsro_telemetry.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+static int writeMatrix( const char * path, long long m, long long n, int family, double cond, unsigned long long seed ){
+    double * A_1d = (double*)mallocChecked( m, n, 1, sizeof(double));
+    generateMatrix( A_1d, m, n, family, cond, seed);
+
+    FILE * f = fopen( path, "wb");
+    if (f == NULL){
+        printf("cannot write %s\n", path);
+        free( A_1d );
+        return 1;
+    }
+    long long k = fwrite( A_1d, sizeof(double), m*n, f);
+    fclose( f );
+    free( A_1d );
+    printf("%s: %lld x %lld, %s, cond = %1.1e, seed = %llu\n", path, m, n, matrixFamilyName(family), cond, seed);
+    return (k == m*n) ? 0 : 1;
+}
+
+// A is generated straight into the region; every job regenerates it (the solver may overwrite A in place)
+static int produceShm( const char * name, long long m, long long n, int ro_steps, int target, int jobs, int inplace, int verify,
+                       int family, double cond, unsigned long long seed ){
+    ShmHeader * h = shmCreate( name, m, n, inplace);
+    if (h == NULL){
+        printf("cannot create %s\n", name);
+        return 1;
+    }
+    printf("%s: %lld x %lld, %1.1f MB%s, waiting for ./cgsro --attach %s\n", name, m, n, h->bytes/1048576.0, inplace ? ", in place" : "", name);
+    fflush( stdout );
+
+    int failed = 0;
+    for (int job = 0; job < jobs; job++){
+        generateMatrix( shmA(h), m, n, family, cond, seed + job);
+        h->ro_steps = ro_steps;
+        h->target = target;
+        h->verify = verify;
+
+        double t = mclock();
+        shmSignal( h, SHM_READY);
+        shmWait( h, SHM_DONE, SHM_DONE);
+        t = mclock() - t;
+        if (h->status != 0)
+            failed++;
+        printf("job %d: %s, status = %d, wall = %1.6f s (solver), %1.6f s (round trip), orth = %1.3e\n", 
+               job+1, h->status == 0 ? "done" : "rejected", h->status, h->wall, t, h->norm);
+    }
+    shmSignal( h, SHM_CLOSE);
+    shmDetach( h );
+    shm_unlink( name );
+    return failed;
+}
+
+int main( int argc, char* argv[] ){
+    if (argc > 2 && strcmp( argv[1], "monitor") == 0)
+        return telemetryMonitor( argv[2], argc > 3 ? strtod( argv[3], NULL ) : 1.0 );
+
+    if (argc > 6 && strcmp( argv[1], "shm") == 0){
+        int jobs = (argc > 7) ? (int)strtol( argv[7], NULL, 10 ) : 1;
+        int inplace = (argc > 8) ? (int)strtol( argv[8], NULL, 10 ) : 0;
+        int verify = (argc > 9) ? (int)strtol( argv[9], NULL, 10 ) : 0;
+        int family = (argc > 10) ? (int)strtol( argv[10], NULL, 10 ) : 1;
+        double cond = (argc > 11) ? strtod( argv[11], NULL ) : 1e6;
+        unsigned long long seed = (argc > 12) ? strtoull( argv[12], NULL, 10 ) : 2018;
+        return produceShm( argv[2], strtoll( argv[3], NULL, 10 ), strtoll( argv[4], NULL, 10 ), (int)strtol( argv[5], NULL, 10 ),
+                           (int)strtol( argv[6], NULL, 10 ), jobs, inplace, verify, family, cond, seed);
+    }
+    if (argc > 4 && strcmp( argv[1], "gen") == 0){
+        int family = (argc > 5) ? (int)strtol( argv[5], NULL, 10 ) : 1;
+        double cond = (argc > 6) ? strtod( argv[6], NULL ) : 1e6;
+        unsigned long long seed = (argc > 7) ? strtoull( argv[7], NULL, 10 ) : 2018;
+        return writeMatrix( argv[2], strtoll( argv[3], NULL, 10 ), strtoll( argv[4], NULL, 10 ), family, cond, seed);
+    }
+    if (argc < 3){
+        printf("usage: %s gen <path> <m> <n> [family [cond [seed]]]\n", argv[0]);
+        printf("       %s <socket> <request> [<request> ...]\n", argv[0]);
+        printf("       %s shm /name <m> <n> <ro_steps> <target> [jobs [inplace [verify [family [cond [seed]]]]]]\n", argv[0]);
+        printf("       %s monitor /name [period]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof(addr.sun_path), "%s", argv[1]);
+    if (fd < 0 || connect( fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+        printf("cannot connect to %s\n", argv[1]);
+        return 1;
+    }
+
+    // all requests go out at once, so that the server queues them as one batch
+    double t = mclock();
+    for (int r = 2; r < argc; r++){
+        char line[1024];
+        int len = snprintf( line, sizeof(line), "%s\n", argv[r]);
+        if (write( fd, line, len) != len){
+            printf("cannot send a request\n");
+            return 1;
+        }
+    }
+
+    // one reply line per request (replies of a batch come in the order of execution)
+    int replies = 0;
+    char buf[4096];
+    int len = 0;
+    while (replies < argc - 2){
+        ssize_t k = read( fd, buf + len, sizeof(buf) - 1 - len);
+        if (k <= 0)
+            break;
+        len += k;
+        buf[len] = '\0';
+        char * line = buf;
+        char * eol;
+        while ((eol = strchr( line, '\n')) != NULL){
+            *eol = '\0';
+            printf("%s\n", line);
+            replies++;
+            line = eol + 1;
+        }
+        len -= (int)(line - buf);
+        memmove( buf, line, len);
+    }
+    close( fd );
+
+    printf("%d replies in %1.3f s\n", replies, mclock() - t);
+    return (replies == argc - 2) ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_complex.cpp : this function incudes a complex-valued CGS-RO for a CPU (OpenACC multicore): A and Q are complex<float> or complex<double>, inner products are conjugated (q^H*v)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Complex data are kept in the interleaved layout of std::complex (re, im, re, im, ...), the kernels work on
+// the underlying real arrays, so the complex dot product and axpy are plain (vectorizable) loops over
+// real pairs with two reductions. Compared with the 2x real embedding [Re -Im; Im Re] (2m x 2n) 
+// the complex CGS-RO needs half of the flops and half of the memory.
+
+#include "helpers.h"
+#include "cgsro_complex.h"
+#include "cgsro_checkpoint.h"
+
+// (re, im) = q^H * v
+template <typename R>
+void complexDot( R * q, R * v, long long m, R * re, R * im){
+
+    R tre = 0.0;
+    R tim = 0.0;
+    if (getReproducibleReductions()){
+        // fixed row-blocks, block sums combined pairwise
+        long long nblocks = reproBlocks( m );
+        ArenaMark mark = arenaMark();
+        R * pre = (R*)arenaAlloc( nblocks, 2, 1, sizeof(R));
+        R * pim = pre + nblocks;
+        #pragma acc parallel loop
+        for (long long b = 0; b < nblocks; b++){
+            long long row1 = (b*REPRO_BLOCK + REPRO_BLOCK < m) ? b*REPRO_BLOCK + REPRO_BLOCK : m;
+            R sre = 0.0, sim = 0.0;
+            for (long long row = b*REPRO_BLOCK; row < row1; row++){
+                R qr = q[2*row], qi = q[2*row+1];
+                R vr = v[2*row], vi = v[2*row+1];
+                sre += qr*vr + qi*vi;
+                sim += qr*vi - qi*vr;
+            }
+            pre[b] = sre;
+            pim[b] = sim;
+        }
+        tre = reproCombine( pre, nblocks );
+        tim = reproCombine( pim, nblocks );
+        arenaRelease( mark );
+    }
+    else{
+        #pragma acc parallel loop reduction(+:tre,tim)
+        for (long long row = 0; row < m; row++){
+            R qr = q[2*row], qi = q[2*row+1];
+            R vr = v[2*row], vi = v[2*row+1];
+            tre += qr*vr + qi*vi;
+            tim += qr*vi - qi*vr;
+        }
+    }
+    *re = tre;
+    *im = tim;
+}
+
+// v = v - (re + i*im) * q
+template <typename R>
+void complexAxpy( R re, R im, R * q, R * v, long long m){
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < m; row++){
+        R qr = q[2*row], qi = q[2*row+1];
+        v[2*row]   -= re*qr - im*qi;
+        v[2*row+1] -= re*qi + im*qr;
+    }
+}
+
+template <typename R>
+void cgsro_complex( std::complex<R> * A_c, std::complex<R> * Q_c, int ro_steps, long long m, long long n, double ** timer){
+
+    double timer_tmp;
+    for(int ii = 0; ii < 9; ii++){
+        timer[ro_steps-1][ii] = 0.0;
+    }
+
+    double time_cgs = mclock();
+    timer_tmp = mclock();
+
+    R * A_1d = reinterpret_cast<R*>(A_c);
+    R * Q_1d = reinterpret_cast<R*>(Q_c);
+
+    ArenaMark mark = arenaMark();
+    R * vold = (R*)arenaAlloc(m, 2, 1, sizeof(R));
+    R * vnew = (R*)arenaAlloc(m, 2, 1, sizeof(R));
+    R * r_re = (R*)arenaAlloc(n, 1, 1, sizeof(R));
+    R * r_im = (R*)arenaAlloc(n, 1, 1, sizeof(R));
+
+    // 0 unless resumed from a checkpoint (a complex column is a real one of length 2m)
+    long long j0 = ckptBegin( "complex", A_1d, Q_1d, 2*m, n, ro_steps);
+
+    timer[ro_steps-1][0] += mclock() - timer_tmp;
+
+    for (long long j = j0; j < n; j++){
+
+        //if ( j % 100 == 0)
+        //    printf("CGS COMPLEX: column=%5lld (%3.0f)\n", j, 100.0*(double)(j)/n );
+
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long idx = 0; idx < 2*m; idx++)
+            vnew[idx] = A_1d[idx + 2*j*m];
+        timer[ro_steps-1][1] += mclock() - timer_tmp;
+
+        R sqrttmp = 0.0;
+        for (int k = 0; k < ro_steps; k++){
+
+            timer_tmp = mclock();
+            #pragma acc parallel loop
+            for (long long idx = 0; idx < 2*m; idx++)
+                vold[idx] = vnew[idx];
+            timer[ro_steps-1][3] += mclock() - timer_tmp;
+
+            // r = Q^H*v_old, v_new = v_new - Q*r
+            timer_tmp = mclock();
+            for (long long i = 0; i < j; i++){
+                complexDot( &Q_1d[2*i*m], vold, m, &r_re[i], &r_im[i]);
+                complexAxpy( r_re[i], r_im[i], &Q_1d[2*i*m], vnew, m);
+            }
+            timer[ro_steps-1][4] += mclock() - timer_tmp;
+
+            timer_tmp = mclock();
+            R tmp = 0.0;
+            if (getReproducibleReductions())
+                tmp = reproDot( vnew, vnew, 2*m);
+            else
+            {
+                #pragma acc parallel loop reduction(+:tmp)
+                for (long long idx = 0; idx < 2*m; idx++)
+                    tmp += vnew[idx] * vnew[idx];
+            }
+            sqrttmp = sqrt(tmp);
+            timer[ro_steps-1][5] += mclock() - timer_tmp;
+        }
+
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long idx = 0; idx < 2*m; idx++)
+            Q_1d[idx + 2*j*m] = vnew[idx] / sqrttmp;
+        timer[ro_steps-1][6] += mclock() - timer_tmp;
+
+        ckptColumn( j+1 );
+    }
+    ckptEnd( n );
+
+    time_cgs = mclock() - time_cgs;
+
+    arenaRelease(mark);
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 7; ii++){
+        time_loop += timer[ro_steps-1][ii];
+    }
+    timer[ro_steps-1][8] = time_loop;
+
+    printf("[CGS-RO COMPLEX] complex<%s>\n", scalarTypeName<R>());
+    printf("[CGS-RO COMPLEX] PHASE               sec. [ %% ] \n"  );
+    printf("[CGS-RO COMPLEX] 1. init          = %1.3f [%3.1f ] \n", timer[ro_steps-1][0], 100.0*timer[ro_steps-1][0] / time_cgs );
+    printf("[CGS-RO COMPLEX] 2. aj            = %1.3f [%3.1f ] \n", timer[ro_steps-1][1], 100.0*timer[ro_steps-1][1] / time_cgs );
+    printf("[CGS-RO COMPLEX] 4. re-ortho      = %1.3f [%3.1f ] \n", timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5], 100.0*(timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5]) / time_cgs);
+    printf("[CGS-RO COMPLEX]  re-ortho(1)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][3], 100.0*timer[ro_steps-1][3] / time_cgs);
+    printf("[CGS-RO COMPLEX]  re-ortho(2)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][4], 100.0*timer[ro_steps-1][4] / time_cgs);
+    printf("[CGS-RO COMPLEX]  re-ortho(3)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs);
+    printf("[CGS-RO COMPLEX] 5. Q             = %1.3f [%3.1f ] \n", timer[ro_steps-1][6], 100.0*timer[ro_steps-1][6] / time_cgs);
+    printf("[CGS-RO COMPLEX] 1-5 CGS-RO       = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs);
+}
+
+template void cgsro_complex( std::complex<float> * A_c, std::complex<float> * Q_c, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_complex( std::complex<double> * A_c, std::complex<double> * Q_c, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_complex( std::complex<long double> * A_c, std::complex<long double> * Q_c, int ro_steps, long long m, long long n, double ** timer);
@@ -0,0 +1,6 @@
+template <typename R>
+void complexDot( R * q, R * v, long long m, R * re, R * im);
+template <typename R>
+void complexAxpy( R re, R im, R * q, R * v, long long m);
+template <typename R>
+void cgsro_complex( std::complex<R> * A_c, std::complex<R> * Q_c, int ro_steps, long long m, long long n, double ** timer);
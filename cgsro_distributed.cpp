@@ -0,0 +1,504 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_distributed.cpp : this function incudes a distributed-memory CGS-RO: rows of A and Q are partitioned across processes (MPI ranks, or forked processes with a shared-memory stand-in of MPI for single node tests)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Every rank owns a contiguous row-block of A and Q. Dot products and norms are computed on the local rows
+// and combined by an allreduce, a single allreduce per projection pass: the norm of column j-1 is not reduced
+// separately, its local part is appended to the first pass of column j (q_{j-1} is normalized afterwards and
+// r_{j-1} is rescaled). Only one extra allreduce is needed for the norm of the last column.
+//
+// Transport (compile time):
+//   -DCGSRO_MPI  - MPI, rank 0 runs the driver and scatters rows of A, the other ranks only run cgsro_distributed (distWorker)
+//   otherwise    - nprocs processes are forked, allreduce goes through shared memory (process-shared barrier)
+//
+// Each rank runs its row-block sequentially, parallelism comes from the number of ranks.
+
+#include "helpers.h"
+#include "cgsro_distributed.h"
+
+#include "string.h"
+#include "limits.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/wait.h"
+
+#ifdef CGSRO_MPI
+#include "mpi.h"
+
+template <typename T> MPI_Datatype mpiType();
+template <> MPI_Datatype mpiType<float>()       { return MPI_FLOAT; }
+template <> MPI_Datatype mpiType<double>()      { return MPI_DOUBLE; }
+template <> MPI_Datatype mpiType<long double>() { return MPI_LONG_DOUBLE; }
+#endif
+
+// nprocs is ignored with MPI (size of MPI_COMM_WORLD), reduce_bytes and gather_bytes size the shared buffers of the stand-in
+int distCommInit( DistComm * comm, int nprocs, long long reduce_bytes, long long gather_bytes ){
+
+#ifdef CGSRO_MPI
+    MPI_Comm_rank( MPI_COMM_WORLD, &comm->rank );
+    MPI_Comm_size( MPI_COMM_WORLD, &comm->size );
+    comm->shared = NULL;
+#else
+    comm->rank = 0;
+    comm->size = nprocs;
+    comm->reduce_bytes = reduce_bytes;
+    comm->gather_bytes = gather_bytes;
+
+    // [barrier][timers: size x 9][reduce slots: size x reduce_bytes][gather buffer]
+    long long header = 64 * ((sizeof(pthread_barrier_t) + 63) / 64);
+    comm->shared_bytes = header + (long long)nprocs * 9 * sizeof(double) + (long long)nprocs * reduce_bytes + gather_bytes;
+    comm->shared = (char*)mmap( NULL, comm->shared_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (comm->shared == MAP_FAILED){
+        printf("[CGS-RO DIST] mmap of %lld bytes failed\n", comm->shared_bytes);
+        exit(1);
+    }
+    comm->barrier = (pthread_barrier_t*)comm->shared;
+    comm->timers  = (double*)(comm->shared + header);
+    comm->slots   = comm->shared + header + (long long)nprocs * 9 * sizeof(double);
+    comm->gather  = comm->slots + (long long)nprocs * reduce_bytes;
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init( &attr );
+    pthread_barrierattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+    pthread_barrier_init( comm->barrier, &attr, nprocs );
+    pthread_barrierattr_destroy( &attr );
+
+    // rank 0 is the calling process
+    fflush(stdout);
+    for (int p = 1; p < nprocs; p++){
+        pid_t pid = fork();
+        if (pid == 0){
+            comm->rank = p;
+            break;
+        }
+        if (pid < 0){
+            printf("[CGS-RO DIST] fork failed\n");
+            exit(1);
+        }
+    }
+#endif
+    return comm->rank;
+}
+
+// the stand-in: ranks > 0 exit, rank 0 waits for them and releases shared memory
+void distCommFinalize( DistComm * comm ){
+#ifndef CGSRO_MPI
+    if (comm->rank != 0)
+        _exit(0);
+    for (int p = 1; p < comm->size; p++)
+        wait(NULL);
+    pthread_barrier_destroy( comm->barrier );
+    munmap( comm->shared, comm->shared_bytes );
+#endif
+}
+
+void distBarrier( DistComm * comm ){
+#ifdef CGSRO_MPI
+    MPI_Barrier( MPI_COMM_WORLD );
+#else
+    pthread_barrier_wait( comm->barrier );
+#endif
+}
+
+// buf (len entries) = sum of buf over all ranks, the sum is taken in rank order on every rank (identical result)
+template <typename T>
+void distAllreduce( DistComm * comm, T * buf, long long len ){
+#ifdef CGSRO_MPI
+    MPI_Allreduce( MPI_IN_PLACE, buf, (int)len, mpiType<T>(), MPI_SUM, MPI_COMM_WORLD );
+#else
+    T * slot = (T*)(comm->slots + comm->rank * comm->reduce_bytes);
+    memcpy( slot, buf, len * sizeof(T) );
+    pthread_barrier_wait( comm->barrier );
+    for (long long i = 0; i < len; i++){
+        T tmp = 0.0;
+        for (int p = 0; p < comm->size; p++)
+            tmp += ((T*)(comm->slots + p * comm->reduce_bytes))[i];
+        buf[i] = tmp;
+    }
+    // slots are reused by the next allreduce
+    pthread_barrier_wait( comm->barrier );
+#endif
+}
+
+// value of rank 0 on every rank (forked ranks inherit it)
+int distBroadcast( DistComm * comm, int value ){
+#ifdef CGSRO_MPI
+    MPI_Bcast( &value, 1, MPI_INT, 0, MPI_COMM_WORLD );
+#endif
+    return value;
+}
+
+// reproducible reductions: out[b] (nblk entries) = sum of x*y over the global block b of REPRO_BLOCK rows, 4 interleaved
+// partial sums as reproDot(...). Rows of a rank start at a block boundary (global block b0), entries of the blocks of
+// other ranks are zero, so the allreduce of out adds exact zeros and its order does not matter
+template <typename T>
+void distBlockDots( T * x, T * y, long long mloc, long long b0, long long nblk, T * out ){
+    for (long long b = 0; b < nblk; b++)
+        out[b] = 0.0;
+    for (long long b = 0; b < reproBlocks( mloc ); b++){
+        long long row0 = b*REPRO_BLOCK;
+        long long row1 = (row0 + REPRO_BLOCK < mloc) ? row0 + REPRO_BLOCK : mloc;
+        T s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        long long row = row0;
+        for ( ; row + 3 < row1; row += 4){
+            s0 += x[row]   * y[row];
+            s1 += x[row+1] * y[row+1];
+            s2 += x[row+2] * y[row+2];
+            s3 += x[row+3] * y[row+3];
+        }
+        for ( ; row < row1; row++)
+            s0 += x[row] * y[row];
+        out[b0 + b] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+// rows [row0, row0+mloc) of A_1d (m x n, rank 0 only) are sent to Aloc (mloc x n) of every rank (MPI only: forked ranks
+// read their rows of A directly)
+#ifdef CGSRO_MPI
+template <typename T>
+void distScatterRows( DistComm * comm, T * A_1d, long long m, long long n, T * Aloc, long long mloc, long long row0 ){
+    int root = (comm->rank == 0);
+#if MPI_VERSION >= 4
+    MPI_Count * counts = (MPI_Count*)mallocChecked(comm->size, 1, 1, sizeof(MPI_Count));
+    MPI_Aint * displs  = (MPI_Aint*)mallocChecked(comm->size, 1, 1, sizeof(MPI_Aint));
+    MPI_Count cnt = mloc;
+    MPI_Aint dsp = row0;
+    MPI_Gather( &cnt, 1, MPI_COUNT, counts, 1, MPI_COUNT, 0, MPI_COMM_WORLD );
+    MPI_Gather( &dsp, 1, MPI_AINT, displs, 1, MPI_AINT, 0, MPI_COMM_WORLD );
+    for (long long j = 0; j < n; j++)
+        MPI_Scatterv_c( root ? &A_1d[j*m] : NULL, counts, displs, mpiType<T>(), &Aloc[j*mloc], cnt, mpiType<T>(), 0, MPI_COMM_WORLD );
+#else
+    if (m > INT_MAX){
+        if (root)
+            printf("[CGS-RO DISTRIBUTED] m = %lld exceeds the int counts of MPI_Scatterv (MPI-%d), an MPI-4 library is needed\n", m, MPI_VERSION);
+        MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+    }
+    int * counts = (int*)mallocChecked(comm->size, 1, 1, sizeof(int));
+    int * displs = (int*)mallocChecked(comm->size, 1, 1, sizeof(int));
+    int cnt = (int)mloc, dsp = (int)row0;
+    MPI_Gather( &cnt, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Gather( &dsp, 1, MPI_INT, displs, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    for (long long j = 0; j < n; j++)
+        MPI_Scatterv( root ? &A_1d[j*m] : NULL, counts, displs, mpiType<T>(), &Aloc[j*mloc], cnt, mpiType<T>(), 0, MPI_COMM_WORLD );
+#endif
+    free(counts); free(displs);
+}
+#endif
+
+// rows [row0, row0+mloc) of every rank are gathered into Q_1d (m x n) on rank 0 (Q_1d is not used on other ranks)
+template <typename T>
+void distGatherRows( DistComm * comm, T * Qloc, long long mloc, long long row0, T * Q_1d, long long m, long long n ){
+#if defined(CGSRO_MPI) && MPI_VERSION >= 4
+    // large counts (MPI-4): row counts and offsets of a column may exceed 2^31
+    MPI_Count * counts = (MPI_Count*)mallocChecked(comm->size, 1, 1, sizeof(MPI_Count));
+    MPI_Aint * displs  = (MPI_Aint*)mallocChecked(comm->size, 1, 1, sizeof(MPI_Aint));
+    MPI_Count cnt = mloc;
+    MPI_Aint dsp = row0;
+    MPI_Gather( &cnt, 1, MPI_COUNT, counts, 1, MPI_COUNT, 0, MPI_COMM_WORLD );
+    MPI_Gather( &dsp, 1, MPI_AINT, displs, 1, MPI_AINT, 0, MPI_COMM_WORLD );
+    for (long long j = 0; j < n; j++)
+        MPI_Gatherv_c( &Qloc[j*mloc], cnt, mpiType<T>(), comm->rank == 0 ? &Q_1d[j*m] : NULL, counts, displs, mpiType<T>(), 0, MPI_COMM_WORLD );
+    free(counts); free(displs);
+#elif defined(CGSRO_MPI)
+    // int counts and offsets (MPI-3): the rows of a column must fit into an int
+    if (m > INT_MAX){
+        if (comm->rank == 0)
+            printf("[CGS-RO DISTRIBUTED] m = %lld exceeds the int counts of MPI_Gatherv (MPI-%d), an MPI-4 library is needed\n", m, MPI_VERSION);
+        MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+    }
+    int * counts = (int*)mallocChecked(comm->size, 1, 1, sizeof(int));
+    int * displs = (int*)mallocChecked(comm->size, 1, 1, sizeof(int));
+    int cnt = (int)mloc, dsp = (int)row0;
+    MPI_Gather( &cnt, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Gather( &dsp, 1, MPI_INT, displs, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    for (long long j = 0; j < n; j++)
+        MPI_Gatherv( &Qloc[j*mloc], cnt, mpiType<T>(), comm->rank == 0 ? &Q_1d[j*m] : NULL, counts, displs, mpiType<T>(), 0, MPI_COMM_WORLD );
+    free(counts); free(displs);
+#else
+    T * Qs = (T*)comm->gather;
+    for (long long j = 0; j < n; j++)
+        for (long long row = 0; row < mloc; row++)
+            Qs[row0 + row + j*m] = Qloc[row + j*mloc];
+    pthread_barrier_wait( comm->barrier );
+    if (comm->rank == 0)
+        memcpy( Q_1d, Qs, m * n * sizeof(T) );
+#endif
+}
+
+// timers (9 entries) of all ranks on rank 0: all[p*9 + ii]
+void distGatherTimers( DistComm * comm, double * local, double * all ){
+#ifdef CGSRO_MPI
+    MPI_Gather( local, 9, MPI_DOUBLE, all, 9, MPI_DOUBLE, 0, MPI_COMM_WORLD );
+#else
+    memcpy( &comm->timers[comm->rank*9], local, 9 * sizeof(double) );
+    pthread_barrier_wait( comm->barrier );
+    if (comm->rank == 0)
+        memcpy( all, comm->timers, comm->size * 9 * sizeof(double) );
+#endif
+}
+
+int distProcs( int nprocs ){
+#ifdef CGSRO_MPI
+    int size;
+    MPI_Comm_size( MPI_COMM_WORLD, &size );
+    return size;
+#else
+    return nprocs < 1 ? 1 : nprocs;
+#endif
+}
+
+template <typename T>
+void cgsro_distributed( T * A_1d, T * Q_1d, int nprocs, int ro_steps, long long m, long long n, double ** timer){
+
+    double timer_tmp;
+    double tloc[9];
+    for(int ii = 0; ii < 9; ii++){
+        tloc[ii] = 0.0;
+    }
+
+    nprocs = distProcs( nprocs );
+
+    double time_cgs = mclock();
+    timer_tmp = mclock();
+
+    // reproducibleReductions (run_cgsro): dots and norms are reduced per global block of REPRO_BLOCK rows, nblk entries each,
+    // and the blocks are combined pairwise, the result does not depend on the number of ranks
+    int repro = getReproducibleReductions();
+    long long nblk = repro ? reproBlocks( m ) : 1;
+
+    DistComm comm;
+    distCommInit( &comm, nprocs, (n+1) * nblk * sizeof(T), m * n * sizeof(T) );
+    repro = distBroadcast( &comm, repro ); // MPI ranks > 0 do not run run_cgsro
+    nblk = repro ? reproBlocks( m ) : 1;
+
+    long long row0 = comm.rank * m / comm.size;
+    long long mloc = (comm.rank + 1) * m / comm.size - row0;
+    long long b0 = 0;
+    if (repro){
+        // row-blocks split at block boundaries: every global block lives on a single rank
+        b0 = comm.rank * nblk / comm.size;
+        long long b1 = (comm.rank + 1) * nblk / comm.size;
+        row0 = (b0*REPRO_BLOCK < m) ? b0*REPRO_BLOCK : m;
+        mloc = ((b1*REPRO_BLOCK < m) ? b1*REPRO_BLOCK : m) - row0;
+    }
+
+    ArenaMark mark = arenaMark();
+    T * Qloc = (T*)arenaAlloc(mloc, n, 1, sizeof(T));
+    // rows of A: with MPI only rank 0 holds A, the other ranks get their row-block (lda = mloc)
+#ifdef CGSRO_MPI
+    T * Aloc = (T*)arenaAlloc(mloc, n, 1, sizeof(T));
+    long long lda = mloc;
+    distScatterRows( &comm, A_1d, m, n, Aloc, mloc, row0 );
+#else
+    T * Aloc = &A_1d[row0];
+    long long lda = m;
+#endif
+    T * vold = (T*)arenaAlloc(mloc, 1, 1, sizeof(T));
+    T * vnew = (T*)arenaAlloc(mloc, 1, 1, sizeof(T));
+    T * r    = (T*)arenaAlloc(n+1, 1, 1, sizeof(T)); // r = Q^T*v and (first pass) ||v_{j-1}||^2
+    T * rb   = (T*)arenaAlloc(n+1, nblk, 1, sizeof(T)); // block sums of r (reproducible reductions)
+
+    tloc[0] += mclock() - timer_tmp;
+
+    for (long long j = 0; j < n; j++){
+
+        timer_tmp = mclock();
+        for (long long row = 0; row < mloc; row++)
+            vnew[row] = Aloc[row + j*lda];
+        tloc[1] += mclock() - timer_tmp;
+
+        for (int k = 0; k < ro_steps; k++){
+
+            timer_tmp = mclock();
+            for (long long row = 0; row < mloc; row++)
+                vold[row] = vnew[row];
+            tloc[3] += mclock() - timer_tmp;
+
+            // local part of r = Q^T*v_old (q_{j-1} is not normalized yet in the first pass)
+            timer_tmp = mclock();
+            long long len = j;
+            for (long long i = 0; i < j; i++){
+                if (repro){
+                    distBlockDots( &Qloc[i*mloc], vold, mloc, b0, nblk, &rb[i*nblk] );
+                    continue;
+                }
+                T tmp1 = 0.0;
+                for (long long row = 0; row < mloc; row++)
+                    tmp1 += Qloc[row + i*mloc] * vold[row];
+                r[i] = tmp1;
+            }
+            tloc[4] += mclock() - timer_tmp;
+
+            timer_tmp = mclock();
+            if (k == 0 && j > 0 && repro)
+                distBlockDots( &Qloc[(j-1)*mloc], &Qloc[(j-1)*mloc], mloc, b0, nblk, &rb[(len++)*nblk] );
+            else if (k == 0 && j > 0){
+                T tmp = 0.0;
+                for (long long row = 0; row < mloc; row++)
+                    tmp += Qloc[row + (j-1)*mloc] * Qloc[row + (j-1)*mloc];
+                r[len++] = tmp;
+            }
+            tloc[5] += mclock() - timer_tmp;
+
+            timer_tmp = mclock();
+            if (repro){
+                distAllreduce( &comm, rb, len*nblk );
+                for (long long i = 0; i < len; i++)
+                    r[i] = reproCombine( &rb[i*nblk], nblk );
+            }
+            else
+                distAllreduce( &comm, r, len );
+            tloc[7] += mclock() - timer_tmp;
+
+            // delayed normalization of q_{j-1}
+            timer_tmp = mclock();
+            if (k == 0 && j > 0){
+                T sqrttmp = sqrt(r[j]);
+                for (long long row = 0; row < mloc; row++)
+                    Qloc[row + (j-1)*mloc] /= sqrttmp;
+                r[j-1] /= sqrttmp;
+            }
+            tloc[6] += mclock() - timer_tmp;
+
+            // v_new = v_new - Q*r
+            timer_tmp = mclock();
+            for (long long row = 0; row < mloc; row++){
+                T tmpx = 0.0;
+                for (long long i = 0; i < j; i++)
+                    tmpx += Qloc[row + i*mloc] * r[i];
+                vnew[row] -= tmpx;
+            }
+            tloc[4] += mclock() - timer_tmp;
+        }
+
+        timer_tmp = mclock();
+        for (long long row = 0; row < mloc; row++)
+            Qloc[row + j*mloc] = vnew[row];
+        tloc[6] += mclock() - timer_tmp;
+    }
+
+    // norm of the last column
+    timer_tmp = mclock();
+    T tmp = 0.0;
+    if (repro)
+        distBlockDots( &Qloc[(n-1)*mloc], &Qloc[(n-1)*mloc], mloc, b0, nblk, rb );
+    else
+        for (long long row = 0; row < mloc; row++)
+            tmp += Qloc[row + (n-1)*mloc] * Qloc[row + (n-1)*mloc];
+    tloc[5] += mclock() - timer_tmp;
+    timer_tmp = mclock();
+    if (repro){
+        distAllreduce( &comm, rb, nblk );
+        tmp = reproCombine( rb, nblk );
+    }
+    else
+        distAllreduce( &comm, &tmp, 1 );
+    tloc[7] += mclock() - timer_tmp;
+    timer_tmp = mclock();
+    T sqrttmp = sqrt(tmp);
+    for (long long row = 0; row < mloc; row++)
+        Qloc[row + (n-1)*mloc] /= sqrttmp;
+    tloc[6] += mclock() - timer_tmp;
+
+    timer_tmp = mclock();
+    distGatherRows( &comm, Qloc, mloc, row0, Q_1d, m, n );
+    tloc[7] += mclock() - timer_tmp;
+
+    arenaRelease(mark);
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 8; ii++){
+        time_loop += tloc[ii];
+    }
+    tloc[8] = time_loop;
+
+    double * all = (double*)mallocChecked(comm.size, 9, 1, sizeof(double));
+    distGatherTimers( &comm, tloc, all );
+    int size = comm.size;
+    distCommFinalize( &comm );
+
+    for(int ii = 0; ii < 9; ii++){
+        timer[ro_steps-1][ii] = tloc[ii];
+    }
+
+    if (comm.rank != 0){
+        free(all);
+        return;
+    }
+
+    time_cgs = mclock() - time_cgs;
+
+    printf("[CGS-RO DIST] ranks = %d, rows per rank = %lld, allreduces = %lld\n", size, m / size, (long long)n*ro_steps + 1);
+    printf("[CGS-RO DIST] PHASE               sec. [ %% ] (rank 0) \n"  );
+    printf("[CGS-RO DIST] 1. init          = %1.3f [%3.1f ] \n", timer[ro_steps-1][0], 100.0*timer[ro_steps-1][0] / time_cgs );
+    printf("[CGS-RO DIST] 2. aj            = %1.3f [%3.1f ] \n", timer[ro_steps-1][1], 100.0*timer[ro_steps-1][1] / time_cgs );
+    printf("[CGS-RO DIST] 4. re-ortho      = %1.3f [%3.1f ] \n", timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5], 100.0*(timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5]) / time_cgs);
+    printf("[CGS-RO DIST]  re-ortho(1)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][3], 100.0*timer[ro_steps-1][3] / time_cgs);
+    printf("[CGS-RO DIST]  re-ortho(2)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][4], 100.0*timer[ro_steps-1][4] / time_cgs);
+    printf("[CGS-RO DIST]  re-ortho(3)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs);
+    printf("[CGS-RO DIST] 5. Q             = %1.3f [%3.1f ] \n", timer[ro_steps-1][6], 100.0*timer[ro_steps-1][6] / time_cgs);
+    printf("[CGS-RO DIST] 6. communication = %1.3f [%3.1f ] \n", timer[ro_steps-1][7], 100.0*timer[ro_steps-1][7] / time_cgs);
+    printf("[CGS-RO DIST] 1-6 CGS-RO       = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs);
+    printf("[CGS-RO DIST] rank   compute [s]   communication [s]\n");
+    for (int p = 0; p < size; p++)
+        printf("[CGS-RO DIST] %4d   %1.3f         %1.3f\n", p, all[p*9+8] - all[p*9+7], all[p*9+7]);
+
+    free(all);
+}
+
+// ranks > 0 of an MPI run: A and Q live on rank 0 only, these ranks take part in the cgsro_distributed calls of its
+// driver (target = 8, s = 1..ro_steps) with their row-blocks
+template <typename T>
+void distWorker( long long m, long long n, int ro_steps ){
+    double ** timer = new double*[ro_steps];
+    for (int i = 0; i < ro_steps; i++)
+        timer[i] = new double[9];
+    for (int s = 1; s <= ro_steps; s++)
+        cgsro_distributed( (T*)NULL, (T*)NULL, 0, s, m, n, timer );
+    for (int i = 0; i < ro_steps; i++)
+        delete [] timer[i];
+    delete [] timer;
+}
+
+// precision: 1 - float, 2 - double, 3 - long double (as run_cgsro)
+void cgsroDistributedWorker( long long m, long long n, int ro_steps, int precision ){
+    if (precision == 1)
+        distWorker<float> ( m, n, ro_steps );
+    else if (precision == 3)
+        distWorker<long double> ( m, n, ro_steps );
+    else
+        distWorker<double> ( m, n, ro_steps );
+}
+
+template void cgsro_distributed( float * A_1d, float * Q_1d, int nprocs, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_distributed( double * A_1d, double * Q_1d, int nprocs, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_distributed( long double * A_1d, long double * Q_1d, int nprocs, int ro_steps, long long m, long long n, double ** timer);
@@ -0,0 +1,32 @@
+#include "pthread.h"
+
+// communicator of the distributed CGS-RO (MPI_COMM_WORLD or the shared-memory stand-in)
+struct DistComm {
+    int rank;
+    int size;
+    // stand-in only:
+    char * shared;
+    long long shared_bytes;
+    long long reduce_bytes;
+    long long gather_bytes;
+    pthread_barrier_t * barrier;
+    double * timers;
+    char * slots;
+    char * gather;
+};
+
+int  distCommInit( DistComm * comm, int nprocs, long long reduce_bytes, long long gather_bytes );
+void distCommFinalize( DistComm * comm );
+void distBarrier( DistComm * comm );
+int  distBroadcast( DistComm * comm, int value );
+template <typename T>
+void distAllreduce( DistComm * comm, T * buf, long long len );
+template <typename T>
+void distGatherRows( DistComm * comm, T * Qloc, long long mloc, long long row0, T * Q_1d, long long m, long long n );
+void distGatherTimers( DistComm * comm, double * local, double * all );
+int  distProcs( int nprocs );
+template <typename T>
+void cgsro_distributed( T * A_1d, T * Q_1d, int nprocs, int ro_steps, long long m, long long n, double ** timer);
+template <typename T>
+void distWorker( long long m, long long n, int ro_steps );
+void cgsroDistributedWorker( long long m, long long n, int ro_steps, int precision );
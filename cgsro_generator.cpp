@@ -0,0 +1,249 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_generator.cpp : this function incudes a parallel and reproducible generator of test matrices (counter-based Philox4x32-10 RNG, families with a prescribed condition number)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Every entry A(i,j) is a function of (seed, i, j) only, so A is identical for any number of threads and any
+// layout (column-major 1D or double**) on a given libm. The random bits are platform-exact, but the normal transform
+// and the spectrum go through log, cos and pow, which are not correctly rounded: glibc, the PGI runtime and CUDA
+// may differ in the last bits. Sums over m (norms of Householder vectors) are taken in blocks of GEN_BLOCK rows
+// which are added in a fixed order.
+//
+// Families (family parameter):
+//   1 - Gaussian          A(i,j) ~ N(0,1)
+//   2 - U*S*V^T           S = diag(cond^(-i/(n-1))), U = H_w*H_u*[I;0], V = H_z (Householder reflectors of random vectors)
+//   3 - graded            A = G*D, G Gaussian, D = diag(cond^(-j/(n-1)))
+//   4 - Lauchli           as initA_version1, epsilon = sqrt(n/(cond^2-1)) gives cond(A) = cond
+
+#include "helpers.h"
+#include "cgsro_generator.h"
+
+#define GEN_BLOCK 16384
+
+#pragma acc routine seq
+void philox4x32( unsigned int * ctr, unsigned int * key, unsigned int * out ){
+
+    unsigned int c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    unsigned int k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; round++){
+        unsigned long long p0 = (unsigned long long)0xD2511F53u * c0;
+        unsigned long long p1 = (unsigned long long)0xCD9E8D57u * c2;
+        unsigned int n0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0;
+        unsigned int n2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (unsigned int)p1;
+        c3 = (unsigned int)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// standard normal number of the stream (seed, stream) at position idx (Box-Muller)
+#pragma acc routine seq
+double genNormal( unsigned long long seed, unsigned int stream, unsigned long long idx ){
+
+    unsigned int ctr[4] = { (unsigned int)idx, (unsigned int)(idx >> 32), stream, 0u };
+    unsigned int key[2] = { (unsigned int)seed, (unsigned int)(seed >> 32) };
+    unsigned int out[4];
+    philox4x32( ctr, key, out );
+
+    // two uniform numbers in (0,1) with 53 bits
+    double u1 = ((double)((((unsigned long long)out[0] >> 5) << 26) | (out[1] >> 6)) + 0.5) / 9007199254740992.0;
+    double u2 = ((double)((((unsigned long long)out[2] >> 5) << 26) | (out[3] >> 6)) + 0.5) / 9007199254740992.0;
+
+    return sqrt(-2.0*log(u1)) * cos(6.283185307179586 * u2);
+}
+
+const char * matrixFamilyName( int family ){
+    if (family == 1) return "Gaussian";
+    if (family == 2) return "U*S*V^T";
+    if (family == 3) return "graded";
+    if (family == 4) return "Lauchli";
+    return "unknown";
+}
+
+// x (len) = unit vector of the normal stream, the norm is summed in blocks of GEN_BLOCK in a fixed order
+void genUnitVector( double * x, long long len, unsigned long long seed, unsigned int stream ){
+
+    long long nblocks = (len + GEN_BLOCK - 1)/GEN_BLOCK;
+    ArenaMark mark = arenaMark();
+    double * part = (double*)arenaAlloc(nblocks, 1, 1, sizeof(double));
+
+    #pragma acc parallel loop
+    for (long long b = 0; b < nblocks; b++){
+        long long row1 = (b+1)*GEN_BLOCK < len ? (b+1)*GEN_BLOCK : len;
+        double tmp = 0.0;
+        for (long long row = b*GEN_BLOCK; row < row1; row++){
+            x[row] = genNormal( seed, stream, row);
+            tmp += x[row] * x[row];
+        }
+        part[b] = tmp;
+    }
+
+    double nrm = 0.0;
+    for (long long b = 0; b < nblocks; b++)
+        nrm += part[b];
+    nrm = sqrt(nrm);
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < len; row++)
+        x[row] /= nrm;
+
+    arenaRelease(mark);
+}
+
+void genInit( GenState * g, long long m, long long n, int family, double cond, unsigned long long seed ){
+
+    g->m = m;
+    g->n = n;
+    g->family = family;
+    g->cond = cond < 1.0 ? 1.0 : cond;
+    g->seed = seed;
+    g->u = g->w = g->z = g->sigma = g->alpha = g->beta = NULL;
+    g->mark = arenaMark();
+    g->epsilon = sqrt((double)n / (g->cond*g->cond - 1.0 > 0.0 ? g->cond*g->cond - 1.0 : 1.0));
+
+    if (family != 2)
+        return;
+
+    long long k = n < m ? n : m;
+    g->u     = (double*)arenaAlloc(m, 1, 1, sizeof(double));
+    g->w     = (double*)arenaAlloc(m, 1, 1, sizeof(double));
+    g->z     = (double*)arenaAlloc(n, 1, 1, sizeof(double));
+    g->sigma = (double*)arenaAlloc(n, 1, 1, sizeof(double));
+    g->alpha = (double*)arenaAlloc(n, 1, 1, sizeof(double));
+    g->beta  = (double*)arenaAlloc(n, 1, 1, sizeof(double));
+
+    genUnitVector( g->u, m, seed, 1);
+    genUnitVector( g->w, m, seed, 2);
+    genUnitVector( g->z, n, seed, 3);
+
+    for (long long i = 0; i < n; i++)
+        g->sigma[i] = (n > 1) ? pow(g->cond, -(double)i/(double)(n-1)) : 1.0;
+
+    // w^T*u (blocked, fixed order)
+    long long nblocks = (m + GEN_BLOCK - 1)/GEN_BLOCK;
+    ArenaMark mark = arenaMark();
+    double * part = (double*)arenaAlloc(nblocks, 1, 1, sizeof(double));
+    double * u = g->u, * w = g->w;
+    #pragma acc parallel loop
+    for (long long b = 0; b < nblocks; b++){
+        long long row1 = (b+1)*GEN_BLOCK < m ? (b+1)*GEN_BLOCK : m;
+        double tmp = 0.0;
+        for (long long row = b*GEN_BLOCK; row < row1; row++)
+            tmp += w[row] * u[row];
+        part[b] = tmp;
+    }
+    double wu = 0.0;
+    for (long long b = 0; b < nblocks; b++)
+        wu += part[b];
+    arenaRelease(mark);
+
+    // B = [S*V^T; 0], B(i,j) = sigma_i*(delta_ij - 2*z_i*z_j), only the first k rows are nonzero
+    // C = H_u*B = B - 2*u*alpha^T, alpha_j = u^T*B(:,j)
+    // A = H_w*C = C - 2*w*beta^T,  beta_j  = w^T*C(:,j) = w^T*B(:,j) - 2*(w^T*u)*alpha_j
+    for (long long j = 0; j < n; j++){
+        double ua = 0.0, wb = 0.0;
+        for (long long i = 0; i < k; i++){
+            double bij = g->sigma[i] * ((i == j ? 1.0 : 0.0) - 2.0*g->z[i]*g->z[j]);
+            ua += g->u[i] * bij;
+            wb += g->w[i] * bij;
+        }
+        g->alpha[j] = ua;
+        g->beta[j]  = wb - 2.0*wu*ua;
+    }
+}
+
+void genFree( GenState * g ){
+    arenaRelease(g->mark);
+}
+
+#pragma acc routine seq
+double genEntry( GenState * g, long long i, long long j ){
+
+    if (g->family == 1)
+        return genNormal( g->seed, 0, (unsigned long long)(i + j*g->m));
+
+    if (g->family == 3)
+        return genNormal( g->seed, 0, (unsigned long long)(i + j*g->m)) * ((g->n > 1) ? pow(g->cond, -(double)j/(double)(g->n-1)) : 1.0);
+
+    if (g->family == 4){
+        if (i == 0)
+            return 1.0;
+        if ((g->m != g->n && i == j+1) || (g->m == g->n && i == j))
+            return g->epsilon;
+        return 0.0;
+    }
+
+    // U*S*V^T
+    double bij = 0.0;
+    if (i < g->n)
+        bij = g->sigma[i] * ((i == j ? 1.0 : 0.0) - 2.0*g->z[i]*g->z[j]);
+    return bij - 2.0*g->u[i]*g->alpha[j] - 2.0*g->w[i]*g->beta[j];
+}
+
+template <typename T>
+void generateMatrix( T * A_1d, long long m, long long n, int family, double cond, unsigned long long seed ){
+
+    GenState g;
+    genInit( &g, m, n, family, cond, seed );
+
+    #pragma acc parallel loop collapse(2)
+    for (long long j = 0; j < n; j++){
+        for (long long i = 0; i < m; i++){
+            A_1d[i + j*m] = (T)genEntry( &g, i, j);
+        }
+    }
+
+    genFree( &g );
+}
+
+void initA_generated( double ** A, long long m, long long n, int family, double cond, unsigned long long seed ){
+
+    GenState g;
+    genInit( &g, m, n, family, cond, seed );
+
+    #pragma acc parallel loop
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
+            A[i][j] = genEntry( &g, i, j);
+        }
+    }
+
+    genFree( &g );
+}
+
+template void generateMatrix( float * A_1d, long long m, long long n, int family, double cond, unsigned long long seed );
+template void generateMatrix( double * A_1d, long long m, long long n, int family, double cond, unsigned long long seed );
+template void generateMatrix( long double * A_1d, long long m, long long n, int family, double cond, unsigned long long seed );
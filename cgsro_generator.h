@@ -0,0 +1,23 @@
+// state of a generated matrix family (vectors of the Householder reflectors of U*S*V^T)
+struct GenState {
+    long long m, n;
+    int family;
+    double cond, epsilon;
+    unsigned long long seed;
+    double * u, * w, * z, * sigma, * alpha, * beta;
+    ArenaMark mark;             // the vectors live in the workspace arena
+};
+
+#pragma acc routine seq
+void philox4x32( unsigned int * ctr, unsigned int * key, unsigned int * out );
+#pragma acc routine seq
+double genNormal( unsigned long long seed, unsigned int stream, unsigned long long idx );
+const char * matrixFamilyName( int family );
+void genUnitVector( double * x, long long len, unsigned long long seed, unsigned int stream );
+void genInit( GenState * g, long long m, long long n, int family, double cond, unsigned long long seed );
+void genFree( GenState * g );
+#pragma acc routine seq
+double genEntry( GenState * g, long long i, long long j );
+template <typename T>
+void generateMatrix( T * A_1d, long long m, long long n, int family, double cond, unsigned long long seed );
+void initA_generated( double ** A, long long m, long long n, int family, double cond, unsigned long long seed );
@@ -33,6 +33,7 @@
 
 #include "helpers.h"
 #include "cgsro_gpu.h"
+#include "cgsro_telemetry.h"
 
 // Explanation: gclock() and mclock() are sibling functions to measure the time taken by a current step (computations, allocations).
 //              However, if here mclock() (defined in helpers.cpp) was called insteed of gclock(), then the following error occurs:
@@ -74,12 +75,13 @@ void testacc(){
         y[i] = x[i]*x[i];
 }
                                                      
-void getColumn_acc_gpu_1d( double * A,  double *a, int rows, int colid){
+template <typename T>
+void getColumn_acc_gpu_1d( T * A,  T *a, long long rows, long long colid){
 
 #pragma acc kernels  
 {
     #pragma acc loop independent
-    for (int i = 0; i < rows; i++){
+    for (long long i = 0; i < rows; i++){
         a[i] = A[i + rows*colid];
     }
 }
@@ -87,18 +89,52 @@ void getColumn_acc_gpu_1d( double * A,  double *a, int rows, int colid){
 }
 
 
-void updatev_acc_gpu_1d( double * vnew, double * vold, int rows, int colid, int zid, int cols, int ro_stepsp){
+template <typename T>
+void updatev_acc_gpu_1d( T * vnew, T * vold, long long rows, long long colid, int zid, long long cols, int ro_stepsp){
 #pragma acc kernels  
 {
     #pragma acc loop independent
-    for (int i = 0; i < rows; i++){
+    for (long long i = 0; i < rows; i++){
         vnew [i + colid*rows   ] = vold [i + colid*rows  ] ;
     }
 }
 }
 
 
-void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, double ** timer ){
+// reproducible reductions: out[i] = sum over rows of X(:,i)*y for i < ncols (X is m x ncols, on the device), split into
+// fixed blocks of REPRO_BLOCK rows as in reproDot(...): block sums P (nblocks x ncols) are computed on the device, copied
+// to the host and combined pairwise by reproCombine(...), so the result does not depend on the launch configuration
+template <typename T>
+void reproBlockDots_gpu( T * X, long long ncols, T * y, long long m, T * P, T * out ){
+
+    long long nblocks = reproBlocks( m );
+
+    #pragma acc parallel loop collapse(2) present(X[0:m*ncols], y[0:m], P[0:nblocks*ncols])
+    for (long long i = 0; i < ncols; i++){
+        for (long long b = 0; b < nblocks; b++){
+            long long row0 = b*REPRO_BLOCK;
+            long long row1 = (row0 + REPRO_BLOCK < m) ? row0 + REPRO_BLOCK : m;
+            T s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+            long long row = row0;
+            for ( ; row + 3 < row1; row += 4){
+                s0 += X[row   + i*m] * y[row];
+                s1 += X[row+1 + i*m] * y[row+1];
+                s2 += X[row+2 + i*m] * y[row+2];
+                s3 += X[row+3 + i*m] * y[row+3];
+            }
+            for ( ; row < row1; row++)
+                s0 += X[row + i*m] * y[row];
+            P[b + i*nblocks] = (s0 + s1) + (s2 + s3);
+        }
+    }
+
+    #pragma acc update self(P[0:nblocks*ncols])
+    for (long long i = 0; i < ncols; i++)
+        out[i] = reproCombine( &P[i*nblocks], nblocks );
+}
+
+template <typename T>
+void cgsro_gpu( T * Q_1d,  T * v_1d, int ro_steps, long long m, long long n, double ** timer ){
 
     double timer_tmp;
     for(int ii = 0; ii < 8; ii++){
@@ -110,35 +146,39 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
 
     int ro_stepsp = ro_steps+1;
 
-    double * aj = (double*)malloc(sizeof(double)*m); 
+    ArenaMark mark = arenaMark();
+    T * aj = (T*)arenaAlloc(m, 1, 1, sizeof(T)); 
 
     // additional tables used in division into 2 stages caluclation of new v_1d
-    double * tab_denominator = (double*)malloc(sizeof(double)*n);
-    double * tab_tmp1 = (double*)malloc(sizeof(double)*n);
+    T * tab_denominator = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+    T * tab_tmp1 = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+    // block sums of the reproducible dots and norms (reproducibleReductions in run_cgsro)
+    int repro = getReproducibleReductions();
+    long long nblocks = reproBlocks( m );
+    T * partial = (T*)arenaAlloc(nblocks, n, 1, sizeof(T));
     
-    for (int jj = 0; jj < n; jj++){
+    for (long long jj = 0; jj < n; jj++){
         tab_denominator[jj] = 0.0;
     }
     
-    for(int tt=0; tt < n; tt++)    
+    for(long long tt=0; tt < n; tt++)    
         tab_tmp1[tt] = 0.0;
 
-    int j, k;
-    int row, col;
+    long long j, k;
+    long long row, col;
 
     #pragma acc enter data copyin(v_1d[0:m*n])
     #pragma acc enter data copyin(aj[0:m])
     #pragma acc enter data copyin(tab_tmp1[0:n])
     #pragma acc enter data copyin(tab_denominator[0:n])
+    #pragma acc enter data create(partial[0:nblocks*n])
 
     timer[ro_steps-1][0] += gclock() - timer_tmp;
+    telemetryBegin( "gpu", m, n, ro_steps);
 
     #pragma acc data copy(Q_1d[0:m*n])
     for ( j = 0; j < n; j++){
 
-        //if ( j % 100 == 0)
-        //    printf("CGS: column=%5d (%3.0f)\n", j, 100.0*(double)(j)/n );
-
         timer_tmp = gclock();
         
         getColumn_acc_gpu_1d( v_1d, aj, m, j);
@@ -150,7 +190,7 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
         timer[ro_steps-1][2] += gclock() - timer_tmp;
     
 
-        double sqrttmp = 0.0;
+        T sqrttmp = 0.0;
         for ( k = 0; k < ro_steps; k++){
         
             timer_tmp = gclock();
@@ -170,57 +210,90 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
             timer[ro_steps-1][3] += gclock() - timer_tmp;
             timer_tmp = gclock();
                 
+            if (repro && j > 0){
+                reproBlockDots_gpu( Q_1d, j, &v_1d[j*m], m, partial, tab_tmp1 );
+                #pragma acc update device(tab_tmp1[0:j])
+                #pragma acc kernels
+                {
+                    #pragma acc loop independent
+                    for ( long long i = 0; i <= j-1; i++)
+                        tab_tmp1[i] *= tab_denominator[i];
+                }
+            }
+            else {
             #pragma acc kernels
             {
                 #pragma acc loop independent         
-                for ( int i = 0; i <= j-1; i++){
+                for ( long long i = 0; i <= j-1; i++){
 
-                    double tmp1 = 0.0;
+                    T tmp1 = 0.0;
 
                     #pragma acc loop reduction(+:tmp1)            
-                    for ( int rowi = 0; rowi < m; rowi++){
+                    for ( long long rowi = 0; rowi < m; rowi++){
                         tmp1 += (Q_1d[rowi+i*m]) * ( v_1d[rowi +  j*m ] ) ;            
                     }
                     tab_tmp1[i] = tmp1*tab_denominator[i];        
                 }
             }
+            }
             
             // First stage [loop parallelizable] :
             #pragma acc kernels
             {
                 #pragma acc loop independent device_type(nvidia) //gang worker (32)        
-                for ( int i = 0; i <= j-1; i++){
+                for ( long long i = 0; i <= j-1; i++){
                     #pragma acc loop independent device_type(nvidia) //vector(32)
-                    for ( int rowi = 0; rowi < m; rowi++)            
+                    for ( long long rowi = 0; rowi < m; rowi++)            
                         v_1d[rowi + i*m  ] = tab_tmp1[i]* (Q_1d[rowi + i*m] *tab_denominator[i]) ;        
                 }
             }// loop i < j-1
             
-            // Second stage [loop reduction]
+            // Second stage [loop reduction], reproducible: the sum over i in a fixed order
+            if (repro){
+            #pragma acc kernels
+            {
+                #pragma acc loop independent
+                for ( long long rowi = 0; rowi < m; rowi++){
+                    T tmpx = 0.0;
+
+                    #pragma acc loop seq
+                    for ( long long i = 0; i <= j-1; i++){
+                        tmpx += v_1d[rowi + i*m ];
+                    }
+                    Q_1d[rowi + j*m  ] -= tmpx;
+                }
+            }
+            }
+            else {
             #pragma acc kernels
             {
                 #pragma acc loop independent  device_type(nvidia) //gang worker (256)
-                for ( int rowi = 0; rowi < m; rowi++){
-                    double tmpx = 0.0;
+                for ( long long rowi = 0; rowi < m; rowi++){
+                    T tmpx = 0.0;
                     
                     #pragma acc loop reduction(+:tmpx)
-                    for ( int i = 0; i <= j-1; i++){
+                    for ( long long i = 0; i <= j-1; i++){
                         tmpx += v_1d[rowi + i*m ];
                     }
                     Q_1d[rowi + j*m  ] -= tmpx; 
                 }
             }
+            }
 
             timer[ro_steps-1][4] += gclock() - timer_tmp;
             timer_tmp = gclock();
             
-            double tmp = 0.0;
+            T tmp = 0.0;
+            if (repro)
+                reproBlockDots_gpu( &Q_1d[j*m], 1, &Q_1d[j*m], m, partial, &tmp );
+            else {
             #pragma acc kernels
             {
                 #pragma acc loop reduction(+:tmp)
-                for ( int row = 0; row < m; row++)
+                for ( long long row = 0; row < m; row++)
                     tmp += Q_1d[ row + j*m ] * Q_1d[ row + j*m ] ;
             }
+            }
         
             sqrttmp = sqrt(tmp);
             
@@ -241,9 +314,9 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
             // update of Q for last column: 
             #pragma acc kernels
             {
-                double denominator;
+                T denominator;
                 #pragma acc loop independent
-                for ( int jj = 0; jj < n; jj++){
+                for ( long long jj = 0; jj < n; jj++){
                     denominator = tab_denominator[jj];
                     #pragma acc loop independent
                     for ( row = 0; row < m; row++){
@@ -252,12 +325,17 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
                 }
             }
             
-            //printf("j = %d, n = %d |END OF Q-updated|\n", j, n);
+            //printf("j = %lld, n = %lld |END OF Q-updated|\n", j, n);
         }
         timer[ro_steps-1][6] += gclock() - timer_tmp;
 
-
+        telemetryColumn( j, ro_steps, m, sizeof(T));
     } // end loop over columns
+    telemetryEnd();
+
+    // device copies are released as well, the next call copies v_1d again
+    #pragma acc exit data delete(v_1d[0:m*n], aj[0:m], tab_tmp1[0:n], tab_denominator[0:n], partial[0:nblocks*n])
+    arenaRelease(mark);
     
     time_cgs = gclock() - time_cgs;
 
@@ -294,6 +372,16 @@ void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, doubl
 
 }
 
+template void cgsro_gpu( float * Q_1d,  float * v_1d, int ro_steps, long long m, long long n, double ** timer );
+template void cgsro_gpu( double * Q_1d,  double * v_1d, int ro_steps, long long m, long long n, double ** timer );
+
+// long double is not supported on a GPU: main rejects target 2 with precision 3, this only satisfies the instantiation 
+// of run_cgsro_scalar<long double> and stops instead of leaving the copy of A as Q
+template <>
+void cgsro_gpu( long double * Q_1d,  long double * v_1d, int ro_steps, long long m, long long n, double ** timer ){
+    printf("[CGS-RO GPU] long double is not supported on a GPU\n");
+    exit( 1 );
+}
 
 #endif
 
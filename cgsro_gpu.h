@@ -1,8 +1,11 @@
 void testacc();
-void getColumn_gpu_1d( double * A,  double *a, int rows, int colid);
-void updatev_gpu_1d  ( double * vnew, double * vold, int rows, int colid, int zid, int cols, int ro_stepsp);
+void getColumn_gpu_1d( double * A,  double *a, long long rows, long long colid);
+void updatev_gpu_1d  ( double * vnew, double * vold, long long rows, long long colid, int zid, long long cols, int ro_stepsp);
 
-void cgsro_gpu ( double * Q_1d,  double * v_1d, int ro_steps, int m, int n, double ** timer );
+template <typename T>
+void cgsro_gpu ( T * Q_1d,  T * v_1d, int ro_steps, long long m, long long n, double ** timer );
+template <>
+void cgsro_gpu ( long double * Q_1d,  long double * v_1d, int ro_steps, long long m, long long n, double ** timer );
 
 
 
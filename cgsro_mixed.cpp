@@ -0,0 +1,346 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_mixed.cpp : this function incudes a mixed-precision CGS-RO for a CPU (OpenACC multicore): A and Q are stored in float (or emulated bfloat16 / fp16), dot products and re-orthogonalization are performed in double
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Storage types of A and Q (storage parameter):
+//   1 - float     (4 bytes, unit roundoff 6.0e-8)
+//   2 - bfloat16  (2 bytes, unit roundoff 3.9e-3, emulated on a CPU: upper half of float)
+//   3 - fp16      (2 bytes, unit roundoff 4.9e-4, emulated on a CPU: IEEE 754 binary16)
+// Only the current column v is kept in double. Loss of orthogonality is bounded by the unit roundoff of
+// the storage type, the optional refinement (cgsro_refine) brings Q back to the double level.
+
+#include "helpers.h"
+#include "cgsro_mixed.h"
+#include "cgsro_checkpoint.h"
+#include "cgsro_refcache.h"
+
+struct bf16 { unsigned short bits; };
+struct fp16 { unsigned short bits; };
+
+#pragma acc routine seq
+inline double toDouble( float x ){ return (double)x; }
+#pragma acc routine seq
+inline void fromDouble( double x, float & y ){ y = (float)x; }
+
+#pragma acc routine seq
+inline double toDouble( bf16 x ){
+    union { unsigned int u; float f; } c;
+    c.u = ((unsigned int)x.bits) << 16;
+    return (double)c.f;
+}
+#pragma acc routine seq
+inline void fromDouble( double x, bf16 & y ){
+    union { unsigned int u; float f; } c;
+    c.f = (float)x;
+    if ((c.u & 0x7fffffffu) > 0x7f800000u){ // NaN
+        y.bits = (unsigned short)((c.u >> 16) | 0x40);
+        return;
+    }
+    c.u += 0x7fffu + ((c.u >> 16) & 1u);    // round to nearest even
+    y.bits = (unsigned short)(c.u >> 16);
+}
+
+#pragma acc routine seq
+inline double toDouble( fp16 x ){
+    unsigned int sign = (x.bits >> 15) & 1u;
+    int          expo = (x.bits >> 10) & 0x1f;
+    unsigned int mant = x.bits & 0x3ffu;
+    double v;
+    if (expo == 0)
+        v = ldexp((double)mant, -24);                  // subnormal
+    else if (expo == 31)
+        v = mant ? NAN : INFINITY;
+    else
+        v = ldexp((double)(mant | 0x400u), expo - 25);
+    return sign ? -v : v;
+}
+#pragma acc routine seq
+inline void fromDouble( double x, fp16 & y ){
+    unsigned short sign = (x < 0.0 || (x == 0.0 && signbit(x))) ? 0x8000 : 0;
+    double a = fabs(x);
+    if (a != a){
+        y.bits = 0x7e00;
+        return;
+    }
+    if (a >= 65520.0){                                  // overflow (after rounding)
+        y.bits = sign | 0x7c00;
+        return;
+    }
+    int e;
+    frexp(a, &e);                                       // a = f * 2^e, f in [0.5, 1)
+    if (e < -13)
+        e = -13;                                        // subnormal range: fixed step 2^-24
+    double q = nearbyint(ldexp(a, 11 - e));             // 11 bits of significand, round to nearest even
+    unsigned int mant = (unsigned int)q;
+    if (mant == 0x800u){                                // rounding carried into the next binade
+        mant = 0x400u;
+        e++;
+    }
+    if (mant < 0x400u)
+        y.bits = sign | (unsigned short)mant;           // subnormal
+    else
+        y.bits = sign | (unsigned short)(((e + 14) << 10) | (mant & 0x3ffu));
+}
+
+const char * mixedStorageName( int storage ){
+    if (storage == 2) return "bfloat16";
+    if (storage == 3) return "fp16";
+    return "float";
+}
+
+int mixedStorageBytes( int storage ){
+    return (storage == 1) ? (int)sizeof(float) : 2;
+}
+
+// q^T*v with q in the storage format, in fixed row-blocks (reproducible reductions)
+template <typename S>
+double reproDotLow( S * q, double * v, long long m ){
+
+    long long nblocks = reproBlocks( m );
+    ArenaMark mark = arenaMark();
+    double * partial = (double*)arenaAlloc( nblocks, 1, 1, sizeof(double));
+
+    #pragma acc parallel loop
+    for (long long b = 0; b < nblocks; b++){
+        long long row1 = (b*REPRO_BLOCK + REPRO_BLOCK < m) ? b*REPRO_BLOCK + REPRO_BLOCK : m;
+        double s0 = 0.0;
+        for (long long row = b*REPRO_BLOCK; row < row1; row++)
+            s0 += toDouble(q[row]) * v[row];
+        partial[b] = s0;
+    }
+
+    double dot = reproCombine( partial, nblocks );
+    arenaRelease( mark );
+    return dot;
+}
+
+template <typename S, typename T>
+void cgsroMixedKernel( T * A_1d, T * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer){
+
+    double timer_tmp = mclock();
+
+    ArenaMark mark = arenaMark();
+    S * Alow_1d = (S*)arenaAlloc(m, n, 1, sizeof(S));
+    S * Qlow_1d = (S*)arenaAlloc(m, n, 1, sizeof(S));
+    double * v  = (double*)arenaAlloc(m, 1, 1, sizeof(double));
+    double * r  = (double*)arenaAlloc(n, 1, 1, sizeof(double));
+
+    #pragma acc parallel loop
+    for (long long idx = 0; idx < m*n; idx++)
+        fromDouble( (double)A_1d[idx], Alow_1d[idx]);
+
+    // 0 unless resumed from a checkpoint of the low-precision Q (one file per storage type)
+    long long j0 = 0;
+    if (checkpointEnabled()){
+        char engine[32];
+        snprintf( engine, sizeof(engine), "mixed_%s", mixedStorageName(storage));
+        j0 = ckptOpen( engine, refCacheKey( A_1d, m, n, ro_steps), Qlow_1d, sizeof(S), m, n, ro_steps);
+    }
+
+    timer[ro_steps-1][0] += mclock() - timer_tmp;
+
+    for (long long j = j0; j < n; j++){
+
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            v[row] = toDouble(Alow_1d[row + j*m]);
+        timer[ro_steps-1][1] += mclock() - timer_tmp;
+
+        double sqrttmp = 0.0;
+        for (int k = 0; k < ro_steps; k++){
+
+            // r = Q^T*v (accumulated in double)
+            timer_tmp = mclock();
+            for (long long i = 0; i < j; i++){
+                double tmp1 = 0.0;
+                if (getReproducibleReductions())
+                    tmp1 = reproDotLow( &Qlow_1d[i*m], v, m);
+                else
+                {
+                    #pragma acc parallel loop reduction(+:tmp1)
+                    for (long long row = 0; row < m; row++)
+                        tmp1 += toDouble(Qlow_1d[row + i*m]) * v[row];
+                }
+                r[i] = tmp1;
+            }
+            timer[ro_steps-1][3] += mclock() - timer_tmp;
+
+            // v = v - Q*r (outer loop over rows, inner over columns)
+            timer_tmp = mclock();
+            #pragma acc parallel loop
+            for (long long row = 0; row < m; row++){
+                double tmpx = 0.0;
+                for (long long i = 0; i < j; i++)
+                    tmpx += toDouble(Qlow_1d[row + i*m]) * r[i];
+                v[row] -= tmpx;
+            }
+            timer[ro_steps-1][4] += mclock() - timer_tmp;
+
+            timer_tmp = mclock();
+            double tmp = 0.0;
+            if (getReproducibleReductions())
+                tmp = reproDot( v, v, m);
+            else
+            {
+                #pragma acc parallel loop reduction(+:tmp)
+                for (long long row = 0; row < m; row++)
+                    tmp += v[row] * v[row];
+            }
+            sqrttmp = sqrt(tmp);
+            timer[ro_steps-1][5] += mclock() - timer_tmp;
+        }
+
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            fromDouble( v[row]/sqrttmp, Qlow_1d[row + j*m]);
+        timer[ro_steps-1][6] += mclock() - timer_tmp;
+
+        ckptColumn( j+1 );
+    }
+    ckptEnd( n );
+
+    // Q in the input precision for the loss of orthogonality test and refinement
+    timer_tmp = mclock();
+    #pragma acc parallel loop
+    for (long long idx = 0; idx < m*n; idx++)
+        Q_1d[idx] = (T)toDouble(Qlow_1d[idx]);
+
+    arenaRelease(mark);
+    timer[ro_steps-1][0] += mclock() - timer_tmp;
+}
+
+template <typename T>
+void cgsro_mixed( T * A_1d, T * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer){
+
+    for(int ii = 0; ii < 9; ii++){
+        timer[ro_steps-1][ii] = 0.0;
+    }
+
+    double time_cgs = mclock();
+
+    if (storage == 2)
+        cgsroMixedKernel<bf16>  ( A_1d, Q_1d, storage, ro_steps, m, n, timer);
+    else if (storage == 3)
+        cgsroMixedKernel<fp16>  ( A_1d, Q_1d, storage, ro_steps, m, n, timer);
+    else
+        cgsroMixedKernel<float> ( A_1d, Q_1d, storage, ro_steps, m, n, timer);
+
+    time_cgs = mclock() - time_cgs;
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 7; ii++){
+        time_loop += timer[ro_steps-1][ii];
+    }
+    timer[ro_steps-1][8] = time_loop;
+
+    // Q traffic in projection: every pass reads j columns of Q twice (r = Q^T*v, v = v - Q*r)
+    double qreads = 2.0 * ro_steps * (double)m * (double)n * (double)(n-1) / 2.0;
+    double bytes_low    = qreads * mixedStorageBytes(storage);
+    double bytes_double = qreads * sizeof(T);
+
+    printf("[CGS-RO MIXED] storage = %s, accumulation = double\n", mixedStorageName(storage));
+    printf("[CGS-RO MIXED] PHASE               sec. [ %% ] \n"  );
+    printf("[CGS-RO MIXED] 1. init          = %1.3f [%3.1f ] \n", timer[ro_steps-1][0], 100.0*timer[ro_steps-1][0] / time_cgs );
+    printf("[CGS-RO MIXED] 2. aj            = %1.3f [%3.1f ] \n", timer[ro_steps-1][1], 100.0*timer[ro_steps-1][1] / time_cgs );
+    printf("[CGS-RO MIXED] 4. re-ortho      = %1.3f [%3.1f ] \n", timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5], 100.0*(timer[ro_steps-1][3]+timer[ro_steps-1][4]+timer[ro_steps-1][5]) / time_cgs);
+    printf("[CGS-RO MIXED]  re-ortho(1)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][3], 100.0*timer[ro_steps-1][3] / time_cgs);
+    printf("[CGS-RO MIXED]  re-ortho(2)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][4], 100.0*timer[ro_steps-1][4] / time_cgs);
+    printf("[CGS-RO MIXED]  re-ortho(3)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs);
+    printf("[CGS-RO MIXED] 5. Q             = %1.3f [%3.1f ] \n", timer[ro_steps-1][6], 100.0*timer[ro_steps-1][6] / time_cgs);
+    printf("[CGS-RO MIXED] 1-5 CGS-RO       = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs);
+    printf("[CGS-RO MIXED] Q traffic        = %1.3f GB (%s: %1.3f GB, saved %1.3f GB [%3.1f %%])\n", 
+           bytes_low/1e9, scalarTypeName<T>(), bytes_double/1e9, (bytes_double-bytes_low)/1e9, 100.0*(bytes_double-bytes_low)/bytes_double);
+}
+
+// One sweep of CGS with re-orthogonalization in precision T over columns of an (almost) orthonormal Q.
+// Used after cgsro_mixed to bring Q back to T-level orthogonality (time is added to timer[7] and timer[8]).
+template <typename T>
+void cgsro_refine( T * Q_1d, int ro_steps, long long m, long long n, double ** timer){
+
+    double timer_tmp = mclock();
+    ArenaMark mark = arenaMark();
+    T * r = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+
+    for (long long j = 0; j < n; j++){
+        for (int k = 0; k < 2; k++){
+            for (long long i = 0; i < j; i++){
+                T tmp1 = 0.0;
+                if (getReproducibleReductions())
+                    tmp1 = reproDot( &Q_1d[i*m], &Q_1d[j*m], m);
+                else
+                {
+                    #pragma acc parallel loop reduction(+:tmp1)
+                    for (long long row = 0; row < m; row++)
+                        tmp1 += Q_1d[row + i*m] * Q_1d[row + j*m];
+                }
+                r[i] = tmp1;
+            }
+            #pragma acc parallel loop
+            for (long long row = 0; row < m; row++){
+                T tmpx = 0.0;
+                for (long long i = 0; i < j; i++)
+                    tmpx += Q_1d[row + i*m] * r[i];
+                Q_1d[row + j*m] -= tmpx;
+            }
+        }
+        T tmp = 0.0;
+        if (getReproducibleReductions())
+            tmp = reproDot( &Q_1d[j*m], &Q_1d[j*m], m);
+        else
+        {
+            #pragma acc parallel loop reduction(+:tmp)
+            for (long long row = 0; row < m; row++)
+                tmp += Q_1d[row + j*m] * Q_1d[row + j*m];
+        }
+        T sqrttmp = sqrt(tmp);
+
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            Q_1d[row + j*m] /= sqrttmp;
+    }
+    arenaRelease(mark);
+
+    timer_tmp = mclock() - timer_tmp;
+    timer[ro_steps-1][7] += timer_tmp;
+    timer[ro_steps-1][8] += timer_tmp;
+
+    printf("[CGS-RO MIXED] refinement (%s) = %1.3f s\n", scalarTypeName<T>(), timer_tmp);
+}
+
+template void cgsro_mixed( float * A_1d, float * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_mixed( double * A_1d, double * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_mixed( long double * A_1d, long double * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_refine( float * Q_1d, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_refine( double * Q_1d, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_refine( long double * Q_1d, int ro_steps, long long m, long long n, double ** timer);
@@ -0,0 +1,6 @@
+const char * mixedStorageName( int storage );
+int  mixedStorageBytes( int storage );
+template <typename T>
+void cgsro_mixed( T * A_1d, T * Q_1d, int storage, int ro_steps, long long m, long long n, double ** timer);
+template <typename T>
+void cgsro_refine( T * Q_1d, int ro_steps, long long m, long long n, double ** timer);
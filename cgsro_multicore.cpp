@@ -33,6 +33,10 @@
 
 #include "helpers.h"
 #include "cgsro_multicore.h"
+#include "cgsro_blas.h"
+#include "cgsro_checkpoint.h"
+#include "cgsro_telemetry.h"
+#include "cgsro_verifier.h"
 
 double tclock(){
     struct timeval tp;
@@ -45,28 +49,62 @@ double tclock(){
     return sec + usec;
 }
 
-void getColumn_acc_1d( double * A,  double *a, int rows, int colid){
+template <typename T>
+void getColumn_acc_1d( T * A,  T *a, long long rows, long long colid){
     #pragma acc parallel loop
-    for (int i = 0; i < rows; i++){
+    for (long long i = 0; i < rows; i++){
         a[i] = A[i + rows*colid];
     }
 }
 
-void setColumn_acc_1d( double * A,  double *a, int rows, int colid, int zid, int cols){
+// a = A(:,colid) for A in CSC: zeros and a scatter of nonzeros
+template <typename T>
+void getColumnCsc_acc_1d( CscMatrix<T> * A, T * a, long long rows, long long colid){
     #pragma acc parallel loop
-    for (int i = 0; i < rows; i++){
+    for (long long i = 0; i < rows; i++){
+        a[i] = 0.0;
+    }
+    long long p0 = A->colptr[colid], p1 = A->colptr[colid+1];
+    long long * rowidx = A->rowidx;
+    T * val = A->val;
+    #pragma acc parallel loop
+    for (long long p = p0; p < p1; p++){
+        a[rowidx[p]] = val[p];
+    }
+}
+
+template <typename T>
+void setColumn_acc_1d( T * A,  T *a, long long rows, long long colid, int zid, long long cols){
+    #pragma acc parallel loop
+    for (long long i = 0; i < rows; i++){
         A[i+   colid*rows +  zid*(rows*cols)] = a[i] ;
     }
 }
 
-void updatev_acc_1d( double * A, int rows, int colid, int zid, int cols){
+template <typename T>
+void updatev_acc_1d( T * A, long long rows, long long colid, int zid, long long cols){
     #pragma acc parallel loop
-    for (int i = 0; i < rows; i++){
+    for (long long i = 0; i < rows; i++){
         A[i + colid*rows  + (zid+1)*(rows*cols) ] = A[i + colid*rows + zid * (rows*cols) ] ;
     }
 }
 
-void cgsro_multicore( double * A_1d,  double * Q_1d,  int ro_steps, int m, int n, double ** timer){
+// If A_csc is given, columns of A are taken from it and the first projection pass of a sparse column (nnz <= m/CSC_DENSE_RATIO)
+// computes r = Q^T*aj as sparse-dense dot products, i.e. only rows of Q with nonzeros in aj are read. 
+// Columns which are too dense (filled in) are treated as dense.
+#define CSC_DENSE_RATIO 8
+
+// With perm != NULL the CGS-RO is rank-revealing: a column whose norm drops below rank_tol*||aj|| in a projection pass
+// is numerically dependent on the previous ones, it is not normalized and not added to Q (no more passes are made on it 
+// and later columns are not projected against it). Q holds the rank accepted columns (the rest is zeroed), 
+// perm[0..rank-1] are their indices in A, perm[rank..n-1] the dropped columns (-1 for columns not processed because
+// the overlapped verifier stopped the loop). Returns the rank (n without perm).
+// If R_1d != NULL the projection coefficients of all passes are summed into R (n x n, upper triangular, A*P = Q*R): 
+// column c of R belongs to column perm[c] of A (c without perm), R(r,c) is the final norm of an accepted column and 
+// R(0..r-1,c) of a dropped one are its coefficients against the r columns of Q accepted before it.
+template <typename T>
+long long cgsro_multicore( T * A_1d,  T * Q_1d,  int ro_steps, long long m, long long n, double ** timer, CscMatrix<T> * A_csc,
+                           long long * perm, double rank_tol, T * R_1d){
 
     double timer_tmp;
     for(int ii = 0; ii < 8; ii++){
@@ -76,29 +114,63 @@ void cgsro_multicore( double * A_1d,  double * Q_1d,  int ro_steps, int m, int n
     double time_cgs = tclock();
     timer_tmp = tclock();
 
-    double * v_1d = (double*)malloc(sizeof(double)*m*n*(ro_steps+1));
-    double * aj = (double*)malloc(sizeof(double)*m); 
-
-    int j, i, k;
-    int row;
+    ArenaMark mark = arenaMark();
+    T * v_1d = (T*)arenaAlloc(m, n, ro_steps+1, sizeof(T));
+    T * aj = (T*)arenaAlloc(m, 1, 1, sizeof(T)); 
+    T * r_1d = (T*)arenaAlloc(n, 1, 1, sizeof(T)); // projection coefficients r = Q^T*v of a pass
+    T * rj_1d = (T*)arenaAlloc(n, 1, 1, sizeof(T)); // r summed over the passes (R_1d only)
+
+    long long j, i, k;
+    long long row;
+
+    // 0 unless resumed from a checkpoint (not for the rank-revealing CGS-RO, Q columns are not columns of A there,
+    // and not if R is formed, the checkpoint holds no R)
+    long long j0 = (perm == NULL && R_1d == NULL) ? ckptBegin( "multicore", A_1d, Q_1d, m, n, ro_steps) : 0;
+    long long r = j0;           // columns in Q
+    long long dropped = 0;
+
+    if (R_1d != NULL){
+        #pragma acc parallel loop
+        for ( long long idx = 0; idx < n*n; idx++)
+            R_1d[idx] = 0.0;
+    }
 
     timer[ro_steps-1][0] += tclock() - timer_tmp;
+    telemetryBegin( "multicore", m, n, ro_steps);
 
-    for ( j = 0; j < n; j++){
+    for ( j = j0; j < n; j++){
 
-        //if ( j % 100 == 0)
-        //    printf("CGS: column=%5d (%3.0f)\n", j, 100.0*(double)(j)/n );
+        // sparse column: p0..p1-1 are its nonzeros in A_csc
+        long long p0 = 0, p1 = 0;
+        int sparse = 0;
+        if (A_csc != NULL){
+            p0 = A_csc->colptr[j];
+            p1 = A_csc->colptr[j+1];
+            sparse = (p1 - p0) * CSC_DENSE_RATIO <= m;
+        }
 
         timer_tmp = tclock();
-        getColumn_acc_1d( A_1d, aj, m, j);
+        if (A_csc != NULL)
+            getColumnCsc_acc_1d( A_csc, aj, m, j);
+        else
+            getColumn_acc_1d( A_1d, aj, m, j);
         timer[ro_steps-1][1] += tclock() - timer_tmp;
 
         timer_tmp = tclock();
         setColumn_acc_1d( v_1d, aj, m, j, 0, n );
+        T norma = 0.0;          // ||aj|| (rank-revealing only)
+        if (perm != NULL){
+            for ( row = 0; row < m; row++)
+                norma += aj[row] * aj[row];
+            norma = sqrt( norma );
+        }
         timer[ro_steps-1][2] += tclock() - timer_tmp;
     
 
-        double sqrttmp = 0.0;
+        T sqrttmp = 0.0;
+        int dependent = 0;
+        for ( i = 0; i < r; i++)
+            rj_1d[i] = 0.0;
         for ( k = 0; k < ro_steps; k++){
         
             timer_tmp = tclock();
@@ -107,55 +179,157 @@ void cgsro_multicore( double * A_1d,  double * Q_1d,  int ro_steps, int m, int n
             
 
             timer_tmp = tclock();
-            for ( i = 0; i <= j-1; i++){
-             
-                double tmp1  = 0.0;
-                {
-                    #pragma acc parallel loop reduction(+:tmp1) 
-                    for ( int rowi = 0; rowi < m; rowi++){
-                        tmp1 += Q_1d[rowi+i*m] * v_1d[rowi +  j*m + k*m*n];
-                    }
+            if (k == 0 && sparse){
+                long long * rowidx = A_csc->rowidx;
+                T * val = A_csc->val;
+                #pragma acc parallel loop
+                for ( long long ii = 0; ii < r; ii++){
+                    T tmp1 = 0.0;
+                    for (long long p = p0; p < p1; p++)
+                        tmp1 += Q_1d[rowidx[p] + ii*m] * val[p];
+                    r_1d[ii] = tmp1;
                 }
 
-                {
+                for ( i = 0; i < r; i++){
+                    T tmp1 = r_1d[i];
                     #pragma acc parallel loop
-                    for ( int rowi = 0; rowi < m; rowi++)
+                    for ( long long rowi = 0; rowi < m; rowi++)
                         v_1d[rowi + j*m + (k+1)*m*n ] = v_1d[rowi + j*m + (k+1)*m*n ] - tmp1*Q_1d[rowi + i*m];
-
                 }
+            }
+            else if (getProjectionBackend() == 1 && !getReproducibleReductions()){
+                projection_gemv( Q_1d, &v_1d[j*m + k*m*n], &v_1d[j*m + (k+1)*m*n], r_1d, m, r);
+            }
+            else{
+                for ( i = 0; i < r; i++){
+             
+                    T tmp1  = 0.0;
+                    if (getReproducibleReductions())
+                        tmp1 = reproDot( &Q_1d[i*m], &v_1d[j*m + k*m*n], m);
+                    else
+                    {
+                        #pragma acc parallel loop reduction(+:tmp1) 
+                        for ( long long rowi = 0; rowi < m; rowi++){
+                            tmp1 += Q_1d[rowi+i*m] * v_1d[rowi +  j*m + k*m*n];
+                        }
+                    }
+                    r_1d[i] = tmp1;
+
+                    {
+                        #pragma acc parallel loop
+                        for ( long long rowi = 0; rowi < m; rowi++)
+                            v_1d[rowi + j*m + (k+1)*m*n ] = v_1d[rowi + j*m + (k+1)*m*n ] - tmp1*Q_1d[rowi + i*m];
 
+                    }
 
+
+                }
+            }
+            if (R_1d != NULL){
+                for ( i = 0; i < r; i++)
+                    rj_1d[i] += r_1d[i];
             }
+
             timer[ro_steps-1][4] += tclock() - timer_tmp;
              
  
             timer_tmp = tclock();
-            double tmp = 0.0;
+            T tmp = 0.0;
             
-            for ( row = 0; row < m; row++)
-                tmp += v_1d[row + j*m + (k+1)*m*n ] * v_1d[row + j*m + (k+1)*m*n ] ;
+            if (k == 0 && r == 0 && sparse){ // nothing is projected out of the first column
+                for (long long p = p0; p < p1; p++)
+                    tmp += A_csc->val[p] * A_csc->val[p];
+            }
+            else{
+                for ( row = 0; row < m; row++)
+                    tmp += v_1d[row + j*m + (k+1)*m*n ] * v_1d[row + j*m + (k+1)*m*n ] ;
+            }
             
             sqrttmp = sqrt(tmp);
         
             timer[ro_steps-1][5] += tclock() - timer_tmp;
             
-
+            // nothing but rounding is left of aj
+            if (perm != NULL && sqrttmp <= rank_tol * norma){
+                dependent = 1;
+                break;
+            }
 
         }// end re-orthogonalization
         k--;
+
+        if (dependent){
+            perm[n-1-dropped] = j;  // reversed below
+            if (R_1d != NULL){
+                for ( i = 0; i < r; i++)
+                    R_1d[i + (n-1-dropped)*n] = rj_1d[i];
+            }
+            dropped++;
+            telemetryColumn( j, k+2, m, sizeof(T));
+            continue;
+        }
+        if (perm != NULL)
+            perm[r] = j;
+        if (R_1d != NULL){
+            for ( i = 0; i < r; i++)
+                R_1d[i + r*n] = rj_1d[i];
+            R_1d[r + r*n] = sqrttmp;
+        }
            
         timer_tmp = tclock();
         #pragma acc parallel loop 
         for ( row = 0; row < m; row++){
-            Q_1d[row+j*m] = v_1d[row + j*m + (k+1)*m*n]/sqrttmp;
+            Q_1d[row+r*m] = v_1d[row + j*m + (k+1)*m*n]/sqrttmp;
         }
         timer[ro_steps-1][6] += tclock() - timer_tmp;
+        r++;
 
+        ckptColumn( r );
+        telemetryColumn( j, ro_steps, m, sizeof(T));
+        if (verifierColumn( r ))
+            break;              // the overlapped test has found a loss of orthogonality
 
     } // end loop over columns
+    // r == n unless the verifier has stopped the loop: only columns before the failed panel are kept (no checkpoint with perm)
+    ckptEnd( verifierAbortColumn() >= 0 ? verifierAbortColumn() : r );
+    telemetryEnd();
+
+    if (perm != NULL){
+        // dropped columns in the order of A right after the accepted ones, their columns of Q are zero
+        for ( i = 0; i < dropped/2; i++){
+            long long tmp = perm[n-dropped+i];
+            perm[n-dropped+i] = perm[n-1-i];
+            perm[n-1-i] = tmp;
+            if (R_1d != NULL){
+                for ( k = 0; k < n; k++){
+                    T tmpr = R_1d[k + (n-dropped+i)*n];
+                    R_1d[k + (n-dropped+i)*n] = R_1d[k + (n-1-i)*n];
+                    R_1d[k + (n-1-i)*n] = tmpr;
+                }
+            }
+        }
+        // a loop stopped by the verifier leaves columns unprocessed: their perm is -1 (and their R is zero)
+        long long unprocessed = n - r - dropped;
+        for ( i = 0; i < dropped && unprocessed > 0; i++){
+            perm[r+i] = perm[n-dropped+i];
+            if (R_1d != NULL){
+                for ( k = 0; k < n; k++){
+                    R_1d[k + (r+i)*n] = R_1d[k + (n-dropped+i)*n];
+                    R_1d[k + (n-dropped+i)*n] = 0.0;
+                }
+            }
+        }
+        for ( i = r + dropped; i < n; i++)
+            perm[i] = -1;
+        #pragma acc parallel loop
+        for ( long long idx = r*m; idx < n*m; idx++)
+            Q_1d[idx] = 0.0;
+    }
     
     time_cgs = tclock() - time_cgs;
 
+    arenaRelease(mark);
+
     double time_loop = 0.0;
     for(int ii = 0; ii < 7; ii++){
         time_loop += timer[ro_steps-1][ii];
@@ -172,9 +346,63 @@ void cgsro_multicore( double * A_1d,  double * Q_1d,  int ro_steps, int m, int n
     printf("[CGS-RO MULTICORE]  re-ortho(3)      = %1.2f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs);
     printf("[CGS-RO MULTICORE] 5. Q             = %1.3f [%3.1f ] \n", timer[ro_steps-1][6], 100.0*timer[ro_steps-1][6] / time_cgs);
     printf("[CGS-RO MULTICORE] 1-5 CGS-RO       = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs);
+    if (perm != NULL)
+        printf("[CGS-RO MULTICORE] rank            = %lld of %lld (%lld dropped, rank_tol = %1.1e)\n", r, n, dropped, rank_tol);
 
+    return r;
 }
 
+// appends a column: a is orthogonalized against the first k columns of Q (ro_steps passes of CGS),
+// normalized and stored as column k of Q; r[0..k] is the new column of R (r[k] = norm of the projected a)
+template <typename T>
+void cgsro_append( T * Q_1d, T * a, T * r, int ro_steps, long long m, long long k){
+
+    ArenaMark mark = arenaMark();
+    T * v  = (T*)arenaAlloc(m, 1, 1, sizeof(T));
+    T * rk = (T*)arenaAlloc(k+1, 1, 1, sizeof(T));
+
+    #pragma acc parallel loop
+    for ( long long row = 0; row < m; row++)
+        v[row] = a[row];
+    for ( long long i = 0; i < k; i++)
+        r[i] = 0.0;
+
+    for ( int pass = 0; pass < ro_steps; pass++){
+        #pragma acc parallel loop
+        for ( long long i = 0; i < k; i++){
+            T tmp1 = 0.0;
+            for ( long long row = 0; row < m; row++)
+                tmp1 += Q_1d[row + i*m] * v[row];
+            rk[i] = tmp1;
+        }
+        for ( long long i = 0; i < k; i++){
+            T tmp1 = rk[i];
+            #pragma acc parallel loop
+            for ( long long row = 0; row < m; row++)
+                v[row] = v[row] - tmp1*Q_1d[row + i*m];
+            r[i] += tmp1;
+        }
+    }
+
+    T tmp = 0.0;
+    for ( long long row = 0; row < m; row++)
+        tmp += v[row] * v[row];
+    r[k] = sqrt(tmp);
 
+    #pragma acc parallel loop
+    for ( long long row = 0; row < m; row++)
+        Q_1d[row + k*m] = v[row]/r[k];
+
+    arenaRelease(mark);
+}
 
+template long long cgsro_multicore( float * A_1d,  float * Q_1d,  int ro_steps, long long m, long long n, double ** timer, CscMatrix<float> * A_csc,
+                                     long long * perm, double rank_tol, float * R_1d);
+template long long cgsro_multicore( double * A_1d,  double * Q_1d,  int ro_steps, long long m, long long n, double ** timer, CscMatrix<double> * A_csc,
+                                     long long * perm, double rank_tol, double * R_1d);
+template long long cgsro_multicore( long double * A_1d,  long double * Q_1d,  int ro_steps, long long m, long long n, double ** timer, CscMatrix<long double> * A_csc,
+                                     long long * perm, double rank_tol, long double * R_1d);
 
+template void cgsro_append( float * Q_1d, float * a, float * r, int ro_steps, long long m, long long k);
+template void cgsro_append( double * Q_1d, double * a, double * r, int ro_steps, long long m, long long k);
+template void cgsro_append( long double * Q_1d, long double * a, long double * r, int ro_steps, long long m, long long k);
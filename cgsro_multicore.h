@@ -1,8 +1,15 @@
-
-void getColumn_acc_1d( double * A,  double *a, int rows, int colid);
-void setColumn_acc_1d( double * A,  double *a, int rows, int colid, int zid, int cols);
-void updatev_acc_1d( double * A, int rows, int colid, int zid, int cols);
-void cgsro_multicore( double * A_1d,  double * Q_1d,  int steps, int m, int n, double ** timer);
+template <typename T>
+void getColumn_acc_1d( T * A,  T *a, long long rows, long long colid);
+template <typename T>
+void setColumn_acc_1d( T * A,  T *a, long long rows, long long colid, int zid, long long cols);
+template <typename T>
+void updatev_acc_1d( T * A, long long rows, long long colid, int zid, long long cols);
+template <typename T>
+void getColumnCsc_acc_1d( CscMatrix<T> * A, T * a, long long rows, long long colid);
+template <typename T>
+long long cgsro_multicore( T * A_1d,  T * Q_1d,  int ro_steps, long long m, long long n, double ** timer, CscMatrix<T> * A_csc = NULL,
+                           long long * perm = NULL, double rank_tol = 1e-10, T * R_1d = NULL);
 
                     
-
+template <typename T>
+void cgsro_append( T * Q_1d, T * a, T * r, int ro_steps, long long m, long long k);
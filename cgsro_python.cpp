@@ -0,0 +1,389 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_python.cpp : a Python extension module (import cgsro) with the engines on NumPy arrays
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Module cgsro:
+//   Q, R = cgsro.factor(A, ro_steps=1, engine=1)          engine: 1 - multicore, 2 - GPU, 3 - TSQR, 4 - CholeskyQR, 6 - mixed
+//   Q, R = cgsro.append_column(Q, R, a, ro_steps=2)       QR of [A a] from the QR of A
+//   Q, R = cgsro.insert_column(Q, R, a, p, ro_steps=2)    QR of A with a inserted as column p (Givens rotations)
+//   Q, R = cgsro.delete_column(Q, R, p)                   QR of A without column p (Givens rotations)
+//   e    = cgsro.orthogonality(Q)                         NormInf(I-Q^T*Q)
+//
+// Inputs are taken through the buffer protocol as Fortran-ordered float64 arrays (numpy.asfortranarray), so
+// the engines read the memory of the NumPy array itself. Q and R are allocated by the module (cgsro.Matrix, 
+// which exports them through the buffer protocol with Fortran strides) and returned as NumPy arrays viewing 
+// that memory (numpy.asarray keeps the cgsro.Matrix alive as its base); without NumPy a memoryview is returned.
+// The GIL is released while an engine runs.
+
+#define PY_SSIZE_T_CLEAN
+#include "Python.h"
+
+#include "helpers.h"
+#include "cgsro_server.h"
+#include "cgsro_multicore.h"
+#include "cgsro_gpu.h"
+#include "cgsro_update.h"
+
+#include "string.h"
+
+// column-major m x n matrix owned by the module
+struct MatrixObject {
+    PyObject_HEAD
+    double * data;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+};
+
+static void matrixDealloc( MatrixObject * self ){
+    free( self->data );
+    Py_TYPE(self)->tp_free( (PyObject*)self );
+}
+
+static int matrixGetBuffer( MatrixObject * self, Py_buffer * view, int flags ){
+    view->obj = (PyObject*)self;
+    Py_INCREF( self );
+    view->buf = self->data;
+    view->len = self->shape[0] * self->shape[1] * sizeof(double);
+    view->readonly = 0;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : NULL;
+    view->ndim = 2;
+    view->shape = self->shape;
+    view->strides = self->strides;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyBufferProcs matrixBuffer = { (getbufferproc)matrixGetBuffer, NULL };
+
+static PyTypeObject MatrixType = { PyVarObject_HEAD_INIT(NULL, 0) "cgsro.Matrix" };
+
+static PyObject * numpyAsarray = NULL;
+
+// m x n Fortran-ordered matrix viewed by a NumPy array
+static PyObject * newMatrix( long long m, long long n, double ** data ){
+    MatrixObject * self = PyObject_New( MatrixObject, &MatrixType);
+    if (self == NULL)
+        return NULL;
+    self->data = (double*)malloc( (m*n > 0 ? m*n : 1) * sizeof(double));
+    if (self->data == NULL){
+        Py_DECREF( self );
+        return PyErr_NoMemory();
+    }
+    self->shape[0] = m;
+    self->shape[1] = n;
+    self->strides[0] = sizeof(double);
+    self->strides[1] = m * sizeof(double);
+    *data = self->data;
+
+    if (numpyAsarray == NULL)
+        return PyMemoryView_FromObject( (PyObject*)self );
+    PyObject * array = PyObject_CallFunctionObjArgs( numpyAsarray, (PyObject*)self, NULL);
+    Py_DECREF( self );
+    return array;
+}
+
+// float64 Fortran-ordered buffer of 1 or 2 dimensions
+static int getMatrix( PyObject * obj, Py_buffer * view, long long * m, long long * n, const char * name ){
+    if (PyObject_GetBuffer( obj, view, PyBUF_F_CONTIGUOUS | PyBUF_FORMAT) != 0){
+        PyErr_Format( PyExc_TypeError, "%s must be a Fortran-ordered float64 array (numpy.asfortranarray)", name);
+        return 0;
+    }
+    if (strcmp( view->format, "d") != 0 || view->ndim < 1 || view->ndim > 2){
+        PyErr_Format( PyExc_TypeError, "%s must be a float64 vector or matrix", name);
+        PyBuffer_Release( view );
+        return 0;
+    }
+    *m = view->shape[0];
+    *n = (view->ndim == 2) ? view->shape[1] : 1;
+    return 1;
+}
+
+static PyObject * pyFactor( PyObject * self, PyObject * args, PyObject * kwargs ){
+    static const char * keywords[] = { "A", "ro_steps", "engine", NULL };
+    PyObject * objA;
+    int ro_steps = 1, engine = 1;
+    if (!PyArg_ParseTupleAndKeywords( args, kwargs, "O|ii", (char**)keywords, &objA, &ro_steps, &engine))
+        return NULL;
+    if (ro_steps < 1 || ro_steps > 8 || strcmp( serverEngineName(engine), "unknown") == 0){
+        PyErr_SetString( PyExc_ValueError, "ro_steps must be in 1..8 and engine in (1, 2, 3, 4, 6)");
+        return NULL;
+    }
+
+    Py_buffer viewA;
+    long long m, n;
+    if (!getMatrix( objA, &viewA, &m, &n, "A"))
+        return NULL;
+    if (n > m || n < 1){
+        PyBuffer_Release( &viewA );
+        PyErr_SetString( PyExc_ValueError, "A must be m x n with m >= n >= 1");
+        return NULL;
+    }
+
+    double * Q_1d, * R_1d;
+    PyObject * Q = newMatrix( m, n, &Q_1d);
+    PyObject * R = (Q != NULL) ? newMatrix( n, n, &R_1d) : NULL;
+    if (R == NULL){
+        Py_XDECREF( Q );
+        PyBuffer_Release( &viewA );
+        return NULL;
+    }
+
+    double * A_1d = (double*)viewA.buf;
+    Py_BEGIN_ALLOW_THREADS
+    ArenaMark mark = arenaMark();
+    double ** timer = (double**)arenaAlloc( ro_steps, 1, 1, sizeof(double*));
+    for (int i = 0; i < ro_steps; i++)
+        timer[i] = (double*)arenaAlloc( 9, 1, 1, sizeof(double));
+    serverEngine( engine, A_1d, Q_1d, R_1d, ro_steps, m, n, timer);
+    arenaRelease( mark );
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release( &viewA );
+    return Py_BuildValue( "NN", Q, R);
+}
+
+static PyObject * pyAppendColumn( PyObject * self, PyObject * args, PyObject * kwargs ){
+    static const char * keywords[] = { "Q", "R", "a", "ro_steps", NULL };
+    PyObject * objQ, * objR, * obja;
+    int ro_steps = 2;
+    if (!PyArg_ParseTupleAndKeywords( args, kwargs, "OOO|i", (char**)keywords, &objQ, &objR, &obja, &ro_steps))
+        return NULL;
+
+    Py_buffer viewQ, viewR, viewa;
+    long long m, k, kr, nr, ma, na;
+    if (!getMatrix( objQ, &viewQ, &m, &k, "Q"))
+        return NULL;
+    if (!getMatrix( objR, &viewR, &kr, &nr, "R")){
+        PyBuffer_Release( &viewQ );
+        return NULL;
+    }
+    if (!getMatrix( obja, &viewa, &ma, &na, "a")){
+        PyBuffer_Release( &viewQ );
+        PyBuffer_Release( &viewR );
+        return NULL;
+    }
+
+    PyObject * Q = NULL, * R = NULL;
+    double * Q_1d, * R_1d;
+    if (kr != k || nr != k || ma != m || na != 1 || k >= m || ro_steps < 1)
+        PyErr_SetString( PyExc_ValueError, "Q must be m x k, R k x k and a of length m (k < m, ro_steps >= 1)");
+    else if ((Q = newMatrix( m, k+1, &Q_1d)) != NULL)
+        R = newMatrix( k+1, k+1, &R_1d);
+
+    if (R != NULL){
+        double * Qold = (double*)viewQ.buf;
+        double * Rold = (double*)viewR.buf;
+        double * a = (double*)viewa.buf;
+        Py_BEGIN_ALLOW_THREADS
+        memcpy( Q_1d, Qold, m*k*sizeof(double));
+        for (long long j = 0; j < k; j++){
+            memcpy( &R_1d[j*(k+1)], &Rold[j*k], k*sizeof(double));
+            R_1d[k + j*(k+1)] = 0.0;
+        }
+        cgsro_append( Q_1d, a, &R_1d[k*(k+1)], ro_steps, m, k);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release( &viewQ );
+    PyBuffer_Release( &viewR );
+    PyBuffer_Release( &viewa );
+    if (R == NULL){
+        Py_XDECREF( Q );
+        return NULL;
+    }
+    return Py_BuildValue( "NN", Q, R);
+}
+
+static PyObject * pyInsertColumn( PyObject * self, PyObject * args, PyObject * kwargs ){
+    static const char * keywords[] = { "Q", "R", "a", "p", "ro_steps", NULL };
+    PyObject * objQ, * objR, * obja;
+    long long p;
+    int ro_steps = 2;
+    if (!PyArg_ParseTupleAndKeywords( args, kwargs, "OOOL|i", (char**)keywords, &objQ, &objR, &obja, &p, &ro_steps))
+        return NULL;
+
+    Py_buffer viewQ, viewR, viewa;
+    long long m, k, kr, nr, ma, na;
+    if (!getMatrix( objQ, &viewQ, &m, &k, "Q"))
+        return NULL;
+    if (!getMatrix( objR, &viewR, &kr, &nr, "R")){
+        PyBuffer_Release( &viewQ );
+        return NULL;
+    }
+    if (!getMatrix( obja, &viewa, &ma, &na, "a")){
+        PyBuffer_Release( &viewQ );
+        PyBuffer_Release( &viewR );
+        return NULL;
+    }
+
+    PyObject * Q = NULL, * R = NULL;
+    double * Q_1d, * R_1d;
+    if (kr != k || nr != k || ma != m || na != 1 || k >= m || p < 0 || p > k || ro_steps < 1)
+        PyErr_SetString( PyExc_ValueError, "Q must be m x k, R k x k, a of length m and 0 <= p <= k (k < m, ro_steps >= 1)");
+    else if ((Q = newMatrix( m, k+1, &Q_1d)) != NULL)
+        R = newMatrix( k+1, k+1, &R_1d);
+
+    if (R != NULL){
+        double * Qold = (double*)viewQ.buf;
+        double * Rold = (double*)viewR.buf;
+        double * a = (double*)viewa.buf;
+        Py_BEGIN_ALLOW_THREADS
+        memcpy( Q_1d, Qold, m*k*sizeof(double));
+        for (long long j = 0; j < k; j++)
+            memcpy( &R_1d[j*(k+1)], &Rold[j*k], k*sizeof(double));
+        cgsro_insert_column( Q_1d, R_1d, k+1, a, ro_steps, m, k, p);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release( &viewQ );
+    PyBuffer_Release( &viewR );
+    PyBuffer_Release( &viewa );
+    if (R == NULL){
+        Py_XDECREF( Q );
+        return NULL;
+    }
+    return Py_BuildValue( "NN", Q, R);
+}
+
+static PyObject * pyDeleteColumn( PyObject * self, PyObject * args, PyObject * kwargs ){
+    static const char * keywords[] = { "Q", "R", "p", NULL };
+    PyObject * objQ, * objR;
+    long long p;
+    if (!PyArg_ParseTupleAndKeywords( args, kwargs, "OOL", (char**)keywords, &objQ, &objR, &p))
+        return NULL;
+
+    Py_buffer viewQ, viewR;
+    long long m, k, kr, nr;
+    if (!getMatrix( objQ, &viewQ, &m, &k, "Q"))
+        return NULL;
+    if (!getMatrix( objR, &viewR, &kr, &nr, "R")){
+        PyBuffer_Release( &viewQ );
+        return NULL;
+    }
+
+    PyObject * Q = NULL, * R = NULL;
+    double * Q_1d, * R_1d;
+    if (kr != k || nr != k || k < 1 || p < 0 || p >= k)
+        PyErr_SetString( PyExc_ValueError, "Q must be m x k, R k x k and 0 <= p < k");
+    else if ((Q = newMatrix( m, k-1, &Q_1d)) != NULL)
+        R = newMatrix( k-1, k-1, &R_1d);
+
+    if (R != NULL){
+        double * Qold = (double*)viewQ.buf;
+        double * Rold = (double*)viewR.buf;
+        Py_BEGIN_ALLOW_THREADS
+        // the rotations need the full m x k and k x k, the result is their leading part
+        ArenaMark mark = arenaMark();
+        double * Qw = (double*)arenaAlloc(m, k, 1, sizeof(double));
+        double * Rw = (double*)arenaAlloc(k, k, 1, sizeof(double));
+        memcpy( Qw, Qold, m*k*sizeof(double));
+        memcpy( Rw, Rold, k*k*sizeof(double));
+        cgsro_delete_column( Qw, Rw, k, m, k, p);
+        memcpy( Q_1d, Qw, m*(k-1)*sizeof(double));
+        for (long long j = 0; j < k-1; j++)
+            memcpy( &R_1d[j*(k-1)], &Rw[j*k], (k-1)*sizeof(double));
+        arenaRelease(mark);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release( &viewQ );
+    PyBuffer_Release( &viewR );
+    if (R == NULL){
+        Py_XDECREF( Q );
+        return NULL;
+    }
+    return Py_BuildValue( "NN", Q, R);
+}
+
+static PyObject * pyOrthogonality( PyObject * self, PyObject * args ){
+    PyObject * objQ;
+    if (!PyArg_ParseTuple( args, "O", &objQ))
+        return NULL;
+
+    Py_buffer viewQ;
+    long long m, n;
+    if (!getMatrix( objQ, &viewQ, &m, &n, "Q"))
+        return NULL;
+
+    double norm;
+    double * Q_1d = (double*)viewQ.buf;
+    Py_BEGIN_ALLOW_THREADS
+    norm = orthogonalityNorm( Q_1d, m, n);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release( &viewQ );
+    return PyFloat_FromDouble( norm );
+}
+
+static PyMethodDef cgsroMethods[] = {
+    { "factor", (PyCFunction)(void(*)(void))pyFactor, METH_VARARGS | METH_KEYWORDS, 
+      "factor(A, ro_steps=1, engine=1) -> (Q, R): QR of a Fortran-ordered float64 m x n array" },
+    { "append_column", (PyCFunction)(void(*)(void))pyAppendColumn, METH_VARARGS | METH_KEYWORDS, 
+      "append_column(Q, R, a, ro_steps=2) -> (Q, R): QR with the column a appended" },
+    { "insert_column", (PyCFunction)(void(*)(void))pyInsertColumn, METH_VARARGS | METH_KEYWORDS, 
+      "insert_column(Q, R, a, p, ro_steps=2) -> (Q, R): QR with the column a inserted at position p" },
+    { "delete_column", (PyCFunction)(void(*)(void))pyDeleteColumn, METH_VARARGS | METH_KEYWORDS, 
+      "delete_column(Q, R, p) -> (Q, R): QR with the column p removed" },
+    { "orthogonality", pyOrthogonality, METH_VARARGS, 
+      "orthogonality(Q) -> NormInf(I-Q^T*Q)" },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef cgsroModule = { PyModuleDef_HEAD_INIT, "cgsro", 
+    "ParallelCGS: classical Gram-Schmidt with re-orthogonalization", -1, cgsroMethods };
+
+PyMODINIT_FUNC PyInit_cgsro( void ){
+    MatrixType.tp_basicsize = sizeof(MatrixObject);
+    MatrixType.tp_dealloc = (destructor)matrixDealloc;
+    MatrixType.tp_as_buffer = &matrixBuffer;
+    MatrixType.tp_flags = Py_TPFLAGS_DEFAULT;
+    MatrixType.tp_doc = "column-major matrix owned by cgsro (a NumPy array views it)";
+    if (PyType_Ready( &MatrixType ) < 0)
+        return NULL;
+
+    PyObject * numpy = PyImport_ImportModule( "numpy" );
+    if (numpy != NULL){
+        numpyAsarray = PyObject_GetAttrString( numpy, "asarray" );
+        Py_DECREF( numpy );
+    }
+    PyErr_Clear();
+
+#ifdef _OPENACC
+    testacc();
+#endif
+
+    PyObject * module = PyModule_Create( &cgsroModule );
+    if (module == NULL)
+        return NULL;
+    Py_INCREF( &MatrixType );
+    PyModule_AddObject( module, "Matrix", (PyObject*)&MatrixType );
+    return module;
+}
@@ -0,0 +1,198 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_refcache.cpp : this function incudes an on-disk cache of the sequential reference (Q, timers and the loss of orthogonality), files are reused through mmap
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// A cache file holds the reference CGS-RO of one setup: header (RefCacheHeader) followed by Q (m x n, column-major).
+// The key is a 64-bit FNV-1a hash of (A, m, n, s, sizeof(T)): A is hashed in blocks of REFCACHE_BLOCK entries in
+// parallel, hashes of the blocks are combined in order. Files are written to a temporary name and renamed, so an 
+// interrupted run never leaves a partial entry.
+
+#include "helpers.h"
+#include "cgsro_refcache.h"
+
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+#define REFCACHE_BLOCK 65536
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+#pragma acc routine seq
+unsigned long long fnv1a( const unsigned char * data, long long len, unsigned long long h ){
+    for (long long i = 0; i < len; i++){
+        h ^= data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+template <typename T>
+unsigned long long refCacheKey( T * A_1d, long long m, long long n, int s ){
+
+    long long len = m*n;
+    long long nblocks = (len + REFCACHE_BLOCK - 1)/REFCACHE_BLOCK;
+    ArenaMark mark = arenaMark();
+    unsigned long long * hb = (unsigned long long*)arenaAlloc(nblocks, 1, 1, sizeof(unsigned long long));
+
+    #pragma acc parallel loop
+    for (long long b = 0; b < nblocks; b++){
+        long long cnt = (b+1)*REFCACHE_BLOCK < len ? REFCACHE_BLOCK : len - b*REFCACHE_BLOCK;
+        hb[b] = fnv1a( (const unsigned char*)&A_1d[b*REFCACHE_BLOCK], cnt * sizeof(T), FNV_OFFSET);
+    }
+
+    unsigned long long h = FNV_OFFSET;
+    long long setup[4] = { m, n, (long long)s, (long long)sizeof(T) };
+    h = fnv1a( (const unsigned char*)setup, sizeof(setup), h);
+    h = fnv1a( (const unsigned char*)hb, nblocks * sizeof(unsigned long long), h);
+
+    arenaRelease(mark);
+    return h;
+}
+
+void refCachePath( char * path, size_t len, const char * dir, unsigned long long key ){
+    snprintf( path, len, "%s/cgsro_ref_%016llx.bin", dir, key);
+}
+
+// returns 1 and maps the entry if a valid file exists for the key, 0 otherwise
+int refCacheLoad( const char * dir, unsigned long long key, long long m, long long n, int s, size_t size, RefCache * rc ){
+
+    rc->map = NULL;
+    rc->bytes = 0;
+
+    char path[4096];
+    refCachePath( path, sizeof(path), dir, key);
+
+    int fd = open( path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    long long bytes = (long long)sizeof(RefCacheHeader) + m*n*(long long)size;
+    if (fstat( fd, &st) != 0 || st.st_size != bytes){
+        close(fd);
+        return 0;
+    }
+
+    void * map = mmap( NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    RefCacheHeader * h = (RefCacheHeader*)map;
+    if (memcmp( h->magic, "CGSROREF", 8) != 0 || h->key != key || h->m != m || h->n != n || h->s != s || h->size != (long long)size){
+        munmap( map, bytes);
+        return 0;
+    }
+
+    // Q is read once, sequentially, by the comparison kernel
+    madvise( map, bytes, MADV_SEQUENTIAL);
+
+    rc->map   = map;
+    rc->bytes = bytes;
+    rc->Q     = (char*)map + sizeof(RefCacheHeader);
+    rc->norm  = h->norm;
+    for (int ii = 0; ii < 9; ii++)
+        rc->timer[ii] = h->timer[ii];
+    return 1;
+}
+
+// returns 1 if the entry was written
+int refCacheStore( const char * dir, unsigned long long key, void * Q_1d, long long m, long long n, int s, size_t size, double * timer, double norm ){
+
+    if (mkdir( dir, 0755) != 0 && errno != EEXIST){
+        printf("[REF CACHE] cannot create directory %s\n", dir);
+        return 0;
+    }
+
+    char path[4096], tmp[4096+32];
+    refCachePath( path, sizeof(path), dir, key);
+    snprintf( tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+
+    RefCacheHeader h;
+    memset( &h, 0, sizeof(h));
+    memcpy( h.magic, "CGSROREF", 8);
+    h.key  = key;
+    h.m    = m;
+    h.n    = n;
+    h.s    = s;
+    h.size = (long long)size;
+    h.norm = norm;
+    for (int ii = 0; ii < 9; ii++)
+        h.timer[ii] = timer[ii];
+
+    FILE * f = fopen( tmp, "wb");
+    if (f == NULL){
+        printf("[REF CACHE] cannot write %s\n", tmp);
+        return 0;
+    }
+    int ok = fwrite( &h, sizeof(h), 1, f) == 1 && fwrite( Q_1d, size, m*n, f) == (size_t)(m*n);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename( tmp, path) != 0){
+        printf("[REF CACHE] cannot write %s\n", path);
+        unlink( tmp);
+        return 0;
+    }
+    return 1;
+}
+
+void refCacheRelease( RefCache * rc ){
+    if (rc->map != NULL)
+        munmap( rc->map, rc->bytes);
+    rc->map = NULL;
+}
+
+// max |Q1 - Q2| over len entries, a single streaming pass over both arrays
+template <typename T>
+double maxDiff( T * Q1, T * Q2, long long len ){
+
+    T max = 0.0;
+    #pragma acc parallel loop reduction(max:max)
+    for (long long i = 0; i < len; i++){
+        T d = Q1[i] - Q2[i];
+        if (d < 0)
+            d = -d;
+        if (d > max)
+            max = d;
+    }
+    return (double)max;
+}
+
+template unsigned long long refCacheKey( float * A_1d, long long m, long long n, int s );
+template unsigned long long refCacheKey( double * A_1d, long long m, long long n, int s );
+template unsigned long long refCacheKey( long double * A_1d, long long m, long long n, int s );
+template double maxDiff( float * Q1, float * Q2, long long len );
+template double maxDiff( double * Q1, double * Q2, long long len );
+template double maxDiff( long double * Q1, long double * Q2, long long len );
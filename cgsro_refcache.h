@@ -0,0 +1,29 @@
+// header of a cache file (followed by Q)
+struct RefCacheHeader {
+    char magic[8];              // "CGSROREF"
+    unsigned long long key;
+    long long m, n, s, size;    // setup and sizeof(T)
+    double timer[9];            // timers of cgsro_sequential
+    double norm;                // NormInf(I-Q^T*Q)
+    char pad[16];               // Q starts at a multiple of 16 bytes
+};
+
+// mapped cache entry
+struct RefCache {
+    void * map;
+    long long bytes;
+    void * Q;
+    double timer[9];
+    double norm;
+};
+
+#pragma acc routine seq
+unsigned long long fnv1a( const unsigned char * data, long long len, unsigned long long h );
+template <typename T>
+unsigned long long refCacheKey( T * A_1d, long long m, long long n, int s );
+void refCachePath( char * path, size_t len, const char * dir, unsigned long long key );
+int  refCacheLoad( const char * dir, unsigned long long key, long long m, long long n, int s, size_t size, RefCache * rc );
+int  refCacheStore( const char * dir, unsigned long long key, void * Q_1d, long long m, long long n, int s, size_t size, double * timer, double norm );
+void refCacheRelease( RefCache * rc );
+template <typename T>
+double maxDiff( T * Q1, T * Q2, long long len );
@@ -0,0 +1,297 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_rgs.cpp : this function incudes a randomized (sketched) Gram-Schmidt for a CPU (OpenACC multicore)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Randomized Gram-Schmidt (Balabanov, Grigori: "Randomized Gram-Schmidt process with application to GMRES", 2022).
+// Projection coefficients r are calculated in a sketched space of dimension k (k << m, k ~ 2n):
+//   p = Theta*a_j,  r = argmin || S*r - p ||  (S = Theta*Q, solved by ro_steps passes of CGS in the sketched space),
+//   q = a_j - Q*r,  s = Theta*q,  Q(:,j) = q/||s||,  S(:,j) = s/||s||.
+// Vectors of length m are touched only by the sketch (Theta*a_j, Theta*q) and by the update a_j - Q*r.
+// Sketch types (Theta: k x m):
+//   1 - sparse sign: every column of Theta has RGS_SPARSE_NNZ nonzeros +-1/sqrt(RGS_SPARSE_NNZ),
+//   2 - subsampled randomized Hadamard transform (SRHT): Theta = 1/sqrt(k) * P * H * D * Pi (m padded to the power of 2,
+//       the random row permutation Pi breaks structure of inputs with few nonzero rows, e.g. initA_version1).
+
+#include "helpers.h"
+#include "cgsro_rgs.h"
+
+#define RGS_SPARSE_NNZ 8
+// rows per block in the sparse sketch (partial sketches of row-blocks are summed afterwards)
+#define RGS_BLOCK 16384
+
+// counter-based random numbers: every entry of Theta is a function of its index only 
+unsigned long long rgsHash( unsigned long long x ){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// sparse sign sketch: p = Theta*w, the nonzeros of column row of Theta are generated on the fly from rgsHash(row*64 + ...)
+// (nnz different rows, rejection of repeated indices, then the sign), Theta is never stored
+template <typename T>
+void sketchSparseSign( T * w, T * p, T * ppart, int nnz, long long m, long long k){
+
+    long long nblocks = (m + RGS_BLOCK - 1)/RGS_BLOCK;
+    T sval = 1.0/sqrt((T)nnz);
+
+    #pragma acc parallel loop gang
+    for (long long b = 0; b < nblocks; b++){
+        long long row0 = b*RGS_BLOCK;
+        long long row1 = (row0 + RGS_BLOCK < m) ? row0 + RGS_BLOCK : m;
+        T * pb = &ppart[b*k];
+        for (long long i = 0; i < k; i++)
+            pb[i] = 0.0;
+        for (long long row = row0; row < row1; row++){
+            int idx[RGS_SPARSE_NNZ];
+            unsigned long long c = (unsigned long long)row * 64;
+            for (int t = 0; t < nnz; t++){
+                int id, unique;
+                do{
+                    id = (int)(rgsHash(c++) % (unsigned long long)k);
+                    unique = 1;
+                    for (int tt = 0; tt < t; tt++)
+                        if (idx[tt] == id)
+                            unique = 0;
+                } while (!unique);
+                idx[t] = id;
+                pb[id] += ((rgsHash(c++) & 1) ? sval : -sval) * w[row];
+            }
+        }
+    }
+
+    #pragma acc parallel loop
+    for (long long i = 0; i < k; i++){
+        T tmp = 0.0;
+        for (long long b = 0; b < nblocks; b++)
+            tmp += ppart[b*k + i];
+        p[i] = tmp;
+    }
+}
+
+// SRHT sketch: p = 1/sqrt(k) * P*H*D*Pi*w, x is a workspace of length mp (power of 2 >= m)
+template <typename T>
+void sketchSRHT( T * w, T * p, T * x, T * d, long long * pos, long long * sel, long long m, long long mp, long long k){
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < mp; row++)
+        x[row] = 0.0;
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < m; row++)
+        x[pos[row]] = d[row] * w[row];
+
+    // fast Walsh-Hadamard transform
+    for (int h = 1; h < mp; h *= 2){
+        #pragma acc parallel loop
+        for (long long pair = 0; pair < mp/2; pair++){
+            long long i1 = (pair / h) * 2*h + pair % h;
+            long long i2 = i1 + h;
+            T x1 = x[i1];
+            T x2 = x[i2];
+            x[i1] = x1 + x2;
+            x[i2] = x1 - x2;
+        }
+    }
+
+    T scale = 1.0/sqrt((T)k);
+    #pragma acc parallel loop
+    for (long long i = 0; i < k; i++)
+        p[i] = scale * x[sel[i]];
+}
+
+// sketch size: n <= k <= m
+long long rgsSketchSize( long long k, long long m, long long n){
+    if (k < n)
+        k = n;
+    if (k > m)
+        k = m;
+    return k;
+}
+
+// in float the sketched LS and a_j - Q*r are accumulated in double: RGS is sensitive to the error of q_j, 
+// with float accumulation Theta-orthogonality is lost for cond(A) ~ 1e4
+template <typename T>
+void cgsro_rgs( T * A_1d, T * Q_1d, T * S_1d, int sketch_type, long long k, int ro_steps, long long m, long long n, double ** timer){
+
+    double timer_tmp;
+    for(int ii = 0; ii < 9; ii++){
+        timer[ro_steps-1][ii] = 0.0;
+    }
+
+    double time_cgs = mclock();
+    timer_tmp = mclock();
+
+    k = rgsSketchSize( k, m, n);
+
+    int nnz = (RGS_SPARSE_NNZ < k) ? RGS_SPARSE_NNZ : k;
+    long long mp = 1;
+    while (mp < m)
+        mp *= 2;
+
+    ArenaMark mark = arenaMark();
+    T * aj = (T*)arenaAlloc(m, 1, 1, sizeof(T));
+    T * pj = (T*)arenaAlloc(k, 1, 1, sizeof(T));
+    T * sj = (T*)arenaAlloc(k, 1, 1, sizeof(T));
+    T * r  = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+    T * r2 = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+
+    // sketch data
+    long long * sel = NULL, * pos = NULL;
+    T * d = NULL, * x = NULL, * ppart = NULL;
+
+    if (sketch_type == 1){
+        ppart = (T*)arenaAlloc(k, (m + RGS_BLOCK - 1)/RGS_BLOCK, 1, sizeof(T));
+    }
+    else{
+        d   = (T*)arenaAlloc(m, 1, 1, sizeof(T));
+        x   = (T*)arenaAlloc(mp, 1, 1, sizeof(T));
+        sel = (long long*)arenaAlloc(mp, 1, 1, sizeof(long long));
+        pos = (long long*)arenaAlloc(mp, 1, 1, sizeof(long long));
+
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            d[row] = (rgsHash(row) & 1) ? 1.0 : -1.0;
+
+        // k rows of H sampled without replacement and positions of m rows of w (partial Fisher-Yates shuffles)
+        for (long long i = 0; i < mp; i++){
+            sel[i] = i;
+            pos[i] = i;
+        }
+        for (long long i = 0; i < k; i++){
+            long long t = i + (long long)(rgsHash((unsigned long long)mp + i) % (unsigned long long)(mp - i));
+            long long tmp = sel[i];
+            sel[i] = sel[t];
+            sel[t] = tmp;
+        }
+        for (long long i = 0; i < m; i++){
+            long long t = i + (long long)(rgsHash((unsigned long long)3*mp + i) % (unsigned long long)(mp - i));
+            long long tmp = pos[i];
+            pos[i] = pos[t];
+            pos[t] = tmp;
+        }
+    }
+
+    timer[ro_steps-1][0] += mclock() - timer_tmp;
+
+    for (long long j = 0; j < n; j++){
+
+        //if ( j % 100 == 0)
+        //    printf("RGS: column=%5lld (%3.0f)\n", j, 100.0*(double)(j)/n );
+
+        // p = Theta*a_j
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            aj[row] = A_1d[row + j*m];
+        if (sketch_type == 1)
+            sketchSparseSign( aj, pj, ppart, nnz, m, k);
+        else
+            sketchSRHT( aj, pj, x, d, pos, sel, m, mp, k);
+        timer[ro_steps-1][1] += mclock() - timer_tmp;
+
+        // r = argmin || S*r - p ||, CGS with re-orthogonalization in the sketched space 
+        timer_tmp = mclock();
+        for (long long i = 0; i < j; i++)
+            r[i] = 0.0;
+        for (int kk = 0; kk < ro_steps; kk++){
+            for (long long i = 0; i < j; i++){
+                typename Accumulator<T>::type tmp1 = 0.0;
+                for (long long l = 0; l < k; l++)
+                    tmp1 += S_1d[l + i*k] * pj[l];
+                r2[i] = tmp1;
+            }
+            for (long long i = 0; i < j; i++){
+                r[i] += r2[i];
+                for (long long l = 0; l < k; l++)
+                    pj[l] -= r2[i] * S_1d[l + i*k];
+            }
+        }
+        timer[ro_steps-1][3] += mclock() - timer_tmp;
+
+        // q = a_j - Q*r (outer loop over rows, inner over columns)
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++){
+            typename Accumulator<T>::type tmpx = 0.0;
+            for (long long i = 0; i < j; i++)
+                tmpx += Q_1d[row + i*m] * r[i];
+            Q_1d[row + j*m] = aj[row] - tmpx;
+        }
+        timer[ro_steps-1][4] += mclock() - timer_tmp;
+
+        // s = Theta*q, r_jj = || s ||
+        timer_tmp = mclock();
+        if (sketch_type == 1)
+            sketchSparseSign( &Q_1d[j*m], sj, ppart, nnz, m, k);
+        else
+            sketchSRHT( &Q_1d[j*m], sj, x, d, pos, sel, m, mp, k);
+
+        T tmp = 0.0;
+        for (long long l = 0; l < k; l++)
+            tmp += sj[l] * sj[l];
+        T sqrttmp = sqrt(tmp);
+        timer[ro_steps-1][5] += mclock() - timer_tmp;
+
+        timer_tmp = mclock();
+        #pragma acc parallel loop
+        for (long long row = 0; row < m; row++)
+            Q_1d[row + j*m] = Q_1d[row + j*m] / sqrttmp;
+        for (long long l = 0; l < k; l++)
+            S_1d[l + j*k] = sj[l] / sqrttmp;
+        timer[ro_steps-1][6] += mclock() - timer_tmp;
+    }
+
+    time_cgs = mclock() - time_cgs;
+
+    arenaRelease(mark);
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 7; ii++){
+        time_loop += timer[ro_steps-1][ii];
+    }
+    timer[ro_steps-1][8] = time_loop;
+
+    printf("[RGS] sketch = %s, k = %lld\n", sketch_type == 1 ? "sparse sign" : "SRHT", k);
+    printf("[RGS] PHASE                   sec. [ %% ] \n"  );
+    printf("[RGS] 1. init (Theta)      = %1.3f [%3.1f ] \n", timer[ro_steps-1][0], 100.0*timer[ro_steps-1][0] / time_cgs );
+    printf("[RGS] 2. Theta*aj          = %1.3f [%3.1f ] \n", timer[ro_steps-1][1], 100.0*timer[ro_steps-1][1] / time_cgs );
+    printf("[RGS] 3. sketched LS       = %1.3f [%3.1f ] \n", timer[ro_steps-1][3], 100.0*timer[ro_steps-1][3] / time_cgs );
+    printf("[RGS] 4. aj - Q*r          = %1.3f [%3.1f ] \n", timer[ro_steps-1][4], 100.0*timer[ro_steps-1][4] / time_cgs );
+    printf("[RGS] 5. Theta*q, norm     = %1.3f [%3.1f ] \n", timer[ro_steps-1][5], 100.0*timer[ro_steps-1][5] / time_cgs );
+    printf("[RGS] 6. Q                 = %1.3f [%3.1f ] \n", timer[ro_steps-1][6], 100.0*timer[ro_steps-1][6] / time_cgs );
+    printf("[RGS] 1-6 RGS              = %1.3f [%3.1f ] \n", timer[ro_steps-1][8], 100.0*timer[ro_steps-1][8] / time_cgs );
+}
+
+template void cgsro_rgs( float * A_1d, float * Q_1d, float * S_1d, int sketch_type, long long k, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_rgs( double * A_1d, double * Q_1d, double * S_1d, int sketch_type, long long k, int ro_steps, long long m, long long n, double ** timer);
+template void cgsro_rgs( long double * A_1d, long double * Q_1d, long double * S_1d, int sketch_type, long long k, int ro_steps, long long m, long long n, double ** timer);
@@ -0,0 +1,8 @@
+unsigned long long rgsHash( unsigned long long x );
+template <typename T>
+void sketchSparseSign( T * w, T * p, T * ppart, int nnz, long long m, long long k);
+template <typename T>
+void sketchSRHT( T * w, T * p, T * x, T * d, long long * pos, long long * sel, long long m, long long mp, long long k);
+long long rgsSketchSize( long long k, long long m, long long n);
+template <typename T>
+void cgsro_rgs( T * A_1d, T * Q_1d, T * S_1d, int sketch_type, long long k, int ro_steps, long long m, long long n, double ** timer);
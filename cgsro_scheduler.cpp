@@ -0,0 +1,292 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_scheduler.cpp : a scheduler which runs a queue of jobs concurrently on partitions of the cores
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// The parallel loops of one job are fork/join regions over all cores, so a single job of a typical size 
+// keeps only a few cores busy. The scheduler splits the cores into partitions sized by m*n
+// (SCHED_GRAIN entries per core, at most SCHED_MAX_CORES_PER_JOB) and runs the jobs concurrently:
+// every job is a forked process pinned to its partition (sched_setaffinity) with a thread pool of the same
+// size, set through the runtime (acc_set_num_cores / omp_set_num_threads) in the child, since a runtime which was
+// initialized before the fork ignores ACC_NUM_CORES / OMP_NUM_THREADS (these are set for child runtimes as well).
+// Jobs never run in the scheduling process, so no pool of all cores is inherited by the forked jobs.
+// Jobs are started largest first (LPT) and a job waits until a free run of cores of its partition size exists.
+// The reply of a job comes back through a pipe; per-job wait/run/latency and the aggregate throughput are reported.
+//
+// ./cgsro --schedule <jobfile> [cores]: every line of the file is a request of the job server (QR ...).
+
+#include "helpers.h"
+#include "cgsro_server.h"
+#include "cgsro_scheduler.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "sched.h"
+#include "sys/wait.h"
+#ifdef _OPENACC
+#include "openacc.h"
+#endif
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+// running job
+struct SchedSlot {
+    pid_t pid;
+    int fd;                     // read end of the reply pipe
+    int first, cores;           // partition: cpus[first .. first+cores-1]
+    int job;
+    double t_start;
+};
+
+// cpus of the process (its affinity mask), returns their number
+int schedulerAvailableCores( int * cpus, int len ){
+    cpu_set_t set;
+    int k = 0;
+    if (sched_getaffinity( 0, sizeof(set), &set) == 0){
+        for (int c = 0; c < CPU_SETSIZE && k < len; c++)
+            if (CPU_ISSET( c, &set))
+                cpus[k++] = c;
+    }
+    if (k == 0){
+        cpus[0] = 0;
+        k = 1;
+    }
+    return k;
+}
+
+// right-sized partition of a job
+int schedulerCores( long long m, long long n, int cores ){
+    long long k = (m*n + SCHED_GRAIN - 1) / SCHED_GRAIN;
+    if (k > SCHED_MAX_CORES_PER_JOB)
+        k = SCHED_MAX_CORES_PER_JOB;
+    if (k > cores)
+        k = cores;
+    return (k < 1) ? 1 : (int)k;
+}
+
+static int compareJobSize( const void * a, const void * b ){
+    const ServerJob * x = (const ServerJob*)a;
+    const ServerJob * y = (const ServerJob*)b;
+    double wx = (double)x->m * x->n * x->n * x->ro_steps;
+    double wy = (double)y->m * y->n * y->n * y->ro_steps;
+    if (wx != wy) return (wx > wy) ? -1 : 1;
+    return (x->id < y->id) ? -1 : 1;
+}
+
+// first free run of k cores in busy[0..cores-1], -1 if there is none
+static int findPartition( int * busy, int cores, int k ){
+    for (int first = 0; first + k <= cores; first++){
+        int c = 0;
+        while (c < k && !busy[first + c])
+            c++;
+        if (c == k)
+            return first;
+        first += c;
+    }
+    return -1;
+}
+
+static pid_t startJob( ServerJob * job, int * cpus, int first, int cores, int * fd ){
+    int p[2];
+    if (pipe( p ) != 0)
+        return -1;
+    fflush( stdout );
+    pid_t pid = fork();
+    if (pid == 0){
+        close( p[0] );
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        for (int c = first; c < first + cores; c++)
+            CPU_SET( cpus[c], &set );
+        sched_setaffinity( 0, sizeof(set), &set);
+        char num[16];
+        snprintf( num, sizeof(num), "%d", cores);
+        setenv( "ACC_NUM_CORES", num, 1);
+        setenv( "OMP_NUM_THREADS", num, 1);
+#if defined(_OPENACC) && defined(__PGI)
+        acc_set_num_cores( cores );
+#endif
+#ifdef _OPENMP
+        omp_set_num_threads( cores );
+#endif
+
+        char reply[1024];
+        serverRunJob( job, reply, sizeof(reply));
+        ssize_t k = write( p[1], reply, strlen(reply));
+        fflush( stdout );
+        _exit( k > 0 ? 0 : 1 );
+    }
+    close( p[1] );
+    if (pid < 0){
+        close( p[0] );
+        return -1;
+    }
+    *fd = p[0];
+    return pid;
+}
+
+int schedulerRun( ServerJob * jobs, int njobs, int cores, void (*done)( ServerJob * job, const char * reply, void * arg ), void * arg ){
+    int cpus[CPU_SETSIZE];
+    int ncpus = schedulerAvailableCores( cpus, CPU_SETSIZE);
+    if (cores < 1 || cores > ncpus)
+        cores = ncpus;
+
+    qsort( jobs, njobs, sizeof(ServerJob), compareJobSize);
+
+    int * busy = (int*)mallocChecked( cores, 1, 1, sizeof(int));
+    SchedSlot * slot = (SchedSlot*)mallocChecked( cores, 1, 1, sizeof(SchedSlot));
+    double * wait = (double*)mallocChecked( njobs, 3, 1, sizeof(double));
+    double * run = wait + njobs;
+    double * latency = wait + 2*njobs;
+    int * part = (int*)mallocChecked( njobs, 2, 1, sizeof(int));
+    int * good = part + njobs;
+    for (int c = 0; c < cores; c++)
+        busy[c] = 0;
+    for (int j = 0; j < njobs; j++)
+        part[j] = good[j] = 0;
+
+    double t0 = mclock();
+    int started = 0, running = 0, ok = 0;
+    while (started < njobs || running > 0){
+
+        // start every waiting job whose partition is free (LPT order, smaller jobs fill the gaps)
+        for (int j = 0; j < njobs && running < cores; j++){
+            if (part[j] > 0)
+                continue;
+            int k = schedulerCores( jobs[j].m, jobs[j].n, cores);
+            int first = findPartition( busy, cores, k);
+            if (first < 0)
+                continue;
+
+            SchedSlot * sl = &slot[running];
+            sl->t_start = mclock();
+            sl->pid = startJob( &jobs[j], cpus, first, k, &sl->fd);
+            if (sl->pid < 0)
+                break;
+            sl->first = first;
+            sl->cores = k;
+            sl->job = j;
+            for (int c = first; c < first + k; c++)
+                busy[c] = 1;
+            wait[j] = sl->t_start - t0;
+            part[j] = k;
+            running++;
+            started++;
+        }
+        if (running == 0)
+            break;
+
+        int status;
+        pid_t pid = waitpid( -1, &status, 0);
+        int r = 0;
+        while (r < running && slot[r].pid != pid)
+            r++;
+        if (r == running)
+            continue;
+
+        SchedSlot * sl = &slot[r];
+        char reply[1024];
+        ssize_t k = read( sl->fd, reply, sizeof(reply) - 1);
+        close( sl->fd );
+        if (k <= 0)
+            snprintf( reply, sizeof(reply), "ERR %lld job process failed\n", jobs[sl->job].id);
+        else
+            reply[k] = '\0';
+        if (strncmp( reply, "OK", 2) == 0){
+            good[sl->job] = 1;
+            ok++;
+        }
+
+        run[sl->job] = mclock() - sl->t_start;
+        latency[sl->job] = mclock() - jobs[sl->job].t_queued;
+        for (int c = sl->first; c < sl->first + sl->cores; c++)
+            busy[c] = 0;
+        if (done != NULL)
+            done( &jobs[sl->job], reply, arg);
+        slot[r] = slot[running - 1];
+        running--;
+    }
+    double makespan = mclock() - t0;
+
+    double flops = 0.0;
+    printf("[SCHED] JOB        m     n   s engine     cores   wait [s]    run [s] latency [s]\n");
+    for (int j = 0; j < njobs; j++){
+        if (part[j] == 0)
+            continue;
+        if (good[j])
+            flops += 2.0 * jobs[j].ro_steps * (double)jobs[j].m * jobs[j].n * jobs[j].n;
+        printf("[SCHED] %3lld %8lld %5lld %3d %-10s %5d %10.3f %10.3f %10.3f%s\n", jobs[j].id, jobs[j].m, jobs[j].n, jobs[j].ro_steps, 
+               serverEngineName(jobs[j].target), part[j], wait[j], run[j], latency[j], good[j] ? "" : "  failed");
+    }
+    printf("[SCHED] %d jobs (%d ok) on %d cores: makespan = %1.3f s, throughput = %1.2f jobs/s, %1.2f GFLOP/s (nominal 2*s*m*n^2)\n",
+           started, ok, cores, makespan, started/makespan, flops/makespan*1e-9);
+
+    free( busy );
+    free( slot );
+    free( wait );
+    free( part );
+    return ok;
+}
+
+static void schedulePrint( ServerJob *, const char * reply, void * ){
+    printf("[SCHED] %s", reply);
+    fflush( stdout );
+}
+
+int cgsroSchedule( const char * jobfile, int cores ){
+    FILE * f = (jobfile != NULL) ? fopen( jobfile, "r") : NULL;
+    if (f == NULL){
+        printf("[SCHED] cannot read the job file %s\n", jobfile != NULL ? jobfile : "(null)");
+        return 1;
+    }
+    ServerJob * jobs = (ServerJob*)mallocChecked( SERVER_MAX_JOBS, 1, 1, sizeof(ServerJob));
+    int njobs = 0;
+    char line[1024], err[256];
+    double t = mclock();
+    while (njobs < SERVER_MAX_JOBS && fgets( line, sizeof(line), f) != NULL){
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (!serverParseRequest( line, &jobs[njobs], err, sizeof(err))){
+            printf("[SCHED] skipped: %s", line);
+            continue;
+        }
+        jobs[njobs].id = njobs + 1;
+        jobs[njobs].client = -1;
+        jobs[njobs].t_queued = t;
+        njobs++;
+    }
+    fclose( f );
+
+    int ok = schedulerRun( jobs, njobs, cores, schedulePrint, NULL);
+    free( jobs );
+    return (ok == njobs) ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_scheduler.h : a scheduler which runs a queue of jobs concurrently on partitions of the cores
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// a multicore CGS-RO stops scaling past about 8 cores, larger partitions are not given to a job
+#define SCHED_MAX_CORES_PER_JOB 8
+// entries of A per core of a partition
+#define SCHED_GRAIN (1LL << 21)
+
+int  schedulerAvailableCores( int * cpus, int len );
+int  schedulerCores( long long m, long long n, int cores );
+int  schedulerRun( ServerJob * jobs, int njobs, int cores, void (*done)( ServerJob * job, const char * reply, void * arg ), void * arg );
+int  cgsroSchedule( const char * jobfile, int cores );
@@ -35,26 +35,34 @@
 
 #include "helpers.h"
 #include "cgsro_sequential.h"
+#include "cgsro_blas.h"
+#include "cgsro_checkpoint.h"
+#include "cgsro_telemetry.h"
 
-void getColumn_1d( double * A,  double *a, int rows, int colid){
-    for (int i = 0; i < rows; i++){
+template <typename T>
+void getColumn_1d( T * A,  T *a, long long rows, long long colid){
+    for (long long i = 0; i < rows; i++){
         a[i] = A[i + colid*rows];
     }
 }
 
-void setColumn_1d( double * A,  double *a, int rows, int colid, int zid, int cols){
-    for (int i = 0; i < rows; i++){
+template <typename T>
+void setColumn_1d( T * A,  T *a, long long rows, long long colid, int zid, long long cols){
+    for (long long i = 0; i < rows; i++){
         A[i + colid*rows + zid*rows*cols] = a[i] ;
     }
 }
 
-void updatev_1d( double * A, int rows, int colid, int zid, int cols){
-    for (int i = 0; i < rows; i++){
+template <typename T>
+void updatev_1d( T * A, long long rows, long long colid, int zid, long long cols){
+    for (long long i = 0; i < rows; i++){
         A[i + colid*rows + (zid+1)*rows*cols] = A[i + colid*rows + zid*rows*cols ] ;
     }
 }
 
-void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n, double ** timer){
+// returns the column the loop started at: 0, or j0 > 0 if resumed from a checkpoint (timers cover columns j0..n-1 only)
+template <typename T>
+long long cgsro_sequential( T * A_1d,  T * Q_1d, int steps, long long m, long long n, double ** timer){
 
     double timer_tmp;
     for(int ii = 0; ii < 9; ii++){
@@ -64,21 +72,22 @@ void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n,
     double time_cgs = mclock();
     timer_tmp = mclock();
 
-    double * aj = (double*)malloc(sizeof(double)*m);
-    double * v_1d = (double*)malloc(sizeof(double)*m*n*(steps+1));
-    double * r_1d = (double*)malloc(sizeof(double)*m*n*(steps  ));
+    ArenaMark mark = arenaMark();
+    T * aj = (T*)arenaAlloc(m, 1, 1, sizeof(T));
+    T * v_1d = (T*)arenaAlloc(m, n, steps+1, sizeof(T));
+    T * r_1d = (T*)arenaAlloc(n, 1, 1, sizeof(T)); // projection coefficients r = Q^T*v
 
-    int j, i, k;
-    int row;//, col;
+    long long j, i, k;
+    long long row;//, col;
 
 
-    timer[steps-1][0] += mclock() - timer_tmp;
+    long long j0 = ckptBegin( "sequential", A_1d, Q_1d, m, n, steps); // 0 unless resumed from a checkpoint
 
-    double sqrttmp = 0.0;
-    for ( j = 0; j < n; j++){
+    timer[steps-1][0] += mclock() - timer_tmp;
+    telemetryBegin( "sequential", m, n, steps);
 
-        //if ( j % 100 == 0)
-        //    printf("CGS: column=%5d (%3.0f)\n", j, 100.0*(double)(j)/n );
+    T sqrttmp = 0.0;
+    for ( j = j0; j < n; j++){
 
         timer_tmp = mclock();
         getColumn_1d( A_1d, aj, m, j);
@@ -97,22 +106,27 @@ void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n,
             timer[steps-1][3] += mclock() - timer_tmp;
 
             timer_tmp = mclock();
-            for ( i = 0; i <= j-1; i++){
-      
-                double tmp1 = 0.0;
-                for ( row = 0; row < m; row++){
-                    tmp1 += Q_1d[row + i*m] * v_1d[row + j*m + k*m*n];
+            if (getProjectionBackend() == 1){
+                projection_gemv( Q_1d, &v_1d[j*m + k*m*n], &v_1d[j*m + (k+1)*m*n], r_1d, m, j);
+            }
+            else{
+                for ( i = 0; i <= j-1; i++){
+          
+                    T tmp1 = 0.0;
+                    for ( row = 0; row < m; row++){
+                        tmp1 += Q_1d[row + i*m] * v_1d[row + j*m + k*m*n];
+                    }
+
+                    for ( row = 0; row < m; row++)
+                        v_1d[row + j*m+ (k+1)*m*n] = v_1d[row + j*m + (k+1)*m*n] - tmp1*Q_1d[row + i*m];
+                    
                 }
-
-                for ( row = 0; row < m; row++)
-                    v_1d[row + j*m+ (k+1)*m*n] = v_1d[row + j*m + (k+1)*m*n] - tmp1*Q_1d[row + i*m];
-                
             }
             timer[steps-1][4] += mclock() - timer_tmp;
              
             
             timer_tmp = mclock();
-            double tmp = 0.0;
+            T tmp = 0.0;
             for ( row = 0; row < m; row++)
                 tmp += v_1d[row+j*m+(k+1)*m*n] * v_1d[row+j*m+(k+1)*m*n] ;
             
@@ -128,11 +142,17 @@ void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n,
         }
         timer[steps-1][6] += mclock() - timer_tmp;
 
+        ckptColumn( j+1 );
+        telemetryColumn( j, steps, m, sizeof(T));
 
     } // end loop over columns
+    ckptEnd( n );
+    telemetryEnd();
     
     time_cgs = mclock() - time_cgs;
 
+    arenaRelease(mark);
+
     double time_loop = 0.0;
     for(int ii = 0; ii < 7; ii++){
         time_loop += timer[steps-1][ii];
@@ -150,7 +170,9 @@ void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n,
     printf("[CGS-RO SEQUENTIAL] 5. Q         = %1.3f [%3.1f ] \n", timer[steps-1][6], 100.0*timer[steps-1][6] / time_cgs);
     printf("[CGS-RO SEQUENTIAL] 1-5 CGS-RO   = %1.3f [%3.1f ] \n", timer[steps-1][8], 100.0*timer[steps-1][8] / time_cgs);
 
-
+    return j0;
 }
 
-
+template long long cgsro_sequential( float * A_1d,  float * Q_1d, int steps, long long m, long long n, double ** timer);
+template long long cgsro_sequential( double * A_1d,  double * Q_1d, int steps, long long m, long long n, double ** timer);
+template long long cgsro_sequential( long double * A_1d,  long double * Q_1d, int steps, long long m, long long n, double ** timer);
@@ -1,6 +1,10 @@
-void getColumn_1d( double * A,  double *a, int rows, int colid);
-void setColumn_1d( double * A,  double *a, int rows, int colid, int zid, int cols);
-void updatev_1d( double * A, int rows, int colid, int zid, int cols);
+template <typename T>
+void getColumn_1d( T * A,  T *a, long long rows, long long colid);
+template <typename T>
+void setColumn_1d( T * A,  T *a, long long rows, long long colid, int zid, long long cols);
+template <typename T>
+void updatev_1d( T * A, long long rows, long long colid, int zid, long long cols);
 
-void  cgsro_sequential( double * A_1d,  double * Q_1d, int steps, int m, int n, double ** timer);
+template <typename T>
+long long cgsro_sequential( T * A_1d,  T * Q_1d, int steps, long long m, long long n, double ** timer);
 
@@ -0,0 +1,477 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_server.cpp : a job server which accepts factorization requests over a Unix-domain socket
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Daemon mode (./cgsro --serve <socket>): the process stays alive, so the OpenACC runtime (testacc),
+// the thread pool of the multicore target and the chunks of the workspace arena are warm for every job.
+//
+// Protocol: one request per line, one reply per line:
+//   QR <input> <m> <n> <ro_steps> <target> [output] [verify]
+//                                                   ->  OK <id> Q=<loc> R=<loc> engine=<name> wall=<s> queued=<s> orth=<e>
+//   STATS                                           ->  OK jobs=<k> queued=<k> busy=<s>
+//   SHUTDOWN                                        ->  OK bye
+//   errors                                          ->  ERR <message>
+// <input> is a file or a POSIX shared-memory object (shm:/name) with m*n doubles stored column-major.
+// Q (m x n) and R (n x n, upper triangular) are written as raw doubles to <output>.Q and <output>.R;
+// for shm input the default output is shm:/name_Q and shm:/name_R, otherwise /tmp/cgsro_job_<id>.Q/.R.
+// The loss of orthogonality test costs as much as a CGS pass: it runs only with the verify token (orth=-1 otherwise).
+//
+// Jobs are queued while requests keep arriving (at most SERVER_MAX_JOBS, a full queue is run at once) and the queue 
+// is run as a batch sorted by (target, m, n), so that consecutive jobs of the same size reuse the arena chunks and the device data layout.
+// With ./cgsro --serve <socket> <cores> a batch runs concurrently on partitions of the cores (cgsro_scheduler.cpp).
+// Targets: 1 - multicore CGS-RO, 2 - GPU CGS-RO, 3 - TSQR, 4 - CholeskyQR, 6 - mixed precision + refinement.
+//
+// Attach mode (./cgsro --attach /name): the solver serves a shared-memory region of a producer (cgsro_shm.cpp),
+// A is read and Q written in the region itself, jobs are handed over by futex wake-ups.
+
+#include "helpers.h"
+#include "cgsro_server.h"
+#include "cgsro_shm.h"
+#include "cgsro_scheduler.h"
+#include "cgsro_multicore.h"
+#include "cgsro_gpu.h"
+#include "cgsro_tsqr.h"
+#include "cgsro_cholqr.h"
+#include "cgsro_mixed.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "poll.h"
+#include "signal.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+// connected client: a partial line is kept until its '\n' arrives
+struct ServerClient {
+    int fd;
+    char buf[1024];
+    int len;
+};
+
+const char * serverEngineName( int target ){
+    switch (target){
+        case 1: return "multicore";
+        case 2: return "gpu";
+        case 3: return "tsqr";
+        case 4: return "cholqr";
+        case 6: return "mixed";
+    }
+    return "unknown";
+}
+
+int serverParseRequest( const char * line, ServerJob * job, char * err, size_t len ){
+    char extra[16] = "";
+    job->output[0] = '\0';
+    int k = sscanf( line, "QR %255s %lld %lld %d %d %255s %15s", job->input, &job->m, &job->n, &job->ro_steps, &job->target, 
+                    job->output, extra);
+    job->verify = 0;
+    if (strcmp( job->output, "verify") == 0){
+        job->verify = 1;
+        job->output[0] = '\0';
+    }
+    if (strcmp( extra, "verify") == 0)
+        job->verify = 1;
+    else if (extra[0] != '\0')
+        k = 0;
+    if (k < 5){
+        snprintf( err, len, "usage: QR <input> <m> <n> <ro_steps> <target> [output] [verify]");
+        return 0;
+    }
+    if (job->m < 1 || job->n < 1 || job->n > job->m){
+        snprintf( err, len, "m >= n >= 1 is required");
+        return 0;
+    }
+    if (job->ro_steps < 1 || job->ro_steps > 8){
+        snprintf( err, len, "ro_steps must be in 1..8");
+        return 0;
+    }
+    if (strcmp( serverEngineName(job->target), "unknown") == 0){
+        snprintf( err, len, "target %d is not served (1, 2, 3, 4, 6)", job->target);
+        return 0;
+    }
+    return 1;
+}
+
+// maps a file or shm:/name; input is private (engines may scribble), output is shared and created
+static double * serverMap( const char * loc, long long bytes, int output ){
+    int fd;
+    if (strncmp( loc, "shm:", 4) == 0)
+        fd = output ? shm_open( loc+4, O_RDWR | O_CREAT | O_TRUNC, 0600) : shm_open( loc+4, O_RDONLY, 0);
+    else
+        fd = output ? open( loc, O_RDWR | O_CREAT | O_TRUNC, 0644) : open( loc, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (output ? ftruncate( fd, bytes) != 0 : (fstat( fd, &st) != 0 || st.st_size < bytes)){
+        close( fd );
+        return NULL;
+    }
+    void * p = mmap( NULL, bytes, PROT_READ | PROT_WRITE, output ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close( fd );
+    return (p == MAP_FAILED) ? NULL : (double*)p;
+}
+
+// runs the engine of the target: A_1d -> Q_1d (Q_1d == A_1d is allowed for target 1) and, if R_1d != NULL, A = Q*R.
+// Multicore, TSQR and CholeskyQR return the R they form; the GPU and mixed engines do not, R = Q^T*A is computed for them.
+void serverEngine( int target, double * A_1d, double * Q_1d, double * R_1d, int s, long long m, long long n, double ** timer ){
+    if (target == 1)
+        cgsro_multicore( A_1d, Q_1d, s, m, n, timer, (CscMatrix<double>*)NULL, NULL, 1e-10, R_1d);
+    if (target == 2){
+        // the GPU variant orthogonalizes Q in place and needs A as its work array v
+        ArenaMark mark = arenaMark();
+        double * v_1d = (double*)arenaAlloc( m, n, 1, sizeof(double));
+        memcpy( Q_1d, A_1d, m*n*sizeof(double));
+        memcpy( v_1d, A_1d, m*n*sizeof(double));
+        cgsro_gpu( Q_1d, v_1d, s, m, n, timer);
+        arenaRelease( mark );
+    }
+    if (target == 3)
+        cgsro_tsqr( A_1d, Q_1d, 64, m, n, s, timer, R_1d);
+    if (target == 4)
+        cgsro_cholqr( A_1d, Q_1d, s, m, n, timer, R_1d);
+    if (target == 6){
+        cgsro_mixed( A_1d, Q_1d, 1, s, m, n, timer);
+        cgsro_refine( Q_1d, s, m, n, timer);
+    }
+    if ((target == 2 || target == 6) && R_1d != NULL)
+        formR( Q_1d, A_1d, R_1d, m, n);
+}
+
+int serverRunJob( ServerJob * job, char * reply, size_t len ){
+    long long m = job->m, n = job->n;
+    int s = job->ro_steps;
+    char locQ[300], locR[300];
+
+    if (job->output[0] == '\0'){
+        if (strncmp( job->input, "shm:", 4) == 0)
+            snprintf( job->output, sizeof(job->output), "%s", job->input);
+        else
+            snprintf( job->output, sizeof(job->output), "/tmp/cgsro_job_%lld", job->id);
+    }
+    snprintf( locQ, sizeof(locQ), strncmp( job->output, "shm:", 4) == 0 ? "%s_Q" : "%s.Q", job->output);
+    snprintf( locR, sizeof(locR), strncmp( job->output, "shm:", 4) == 0 ? "%s_R" : "%s.R", job->output);
+
+    double * A_1d = serverMap( job->input, m*n*(long long)sizeof(double), 0);
+    if (A_1d == NULL){
+        snprintf( reply, len, "ERR %lld cannot map %s as %lld x %lld doubles\n", job->id, job->input, m, n);
+        return 0;
+    }
+    double * Q_1d = serverMap( locQ, m*n*(long long)sizeof(double), 1);
+    double * R_1d = serverMap( locR, n*n*(long long)sizeof(double), 1);
+    if (Q_1d == NULL || R_1d == NULL){
+        snprintf( reply, len, "ERR %lld cannot create %s / %s\n", job->id, locQ, locR);
+        munmap( A_1d, m*n*sizeof(double));
+        if (Q_1d != NULL) munmap( Q_1d, m*n*sizeof(double));
+        if (R_1d != NULL) munmap( R_1d, n*n*sizeof(double));
+        return 0;
+    }
+
+    // timers [s][9] live in the arena
+    ArenaMark mark = arenaMark();
+    double ** timer = (double**)arenaAlloc( s, 1, 1, sizeof(double*));
+    for (int i = 0; i < s; i++){
+        timer[i] = (double*)arenaAlloc( 9, 1, 1, sizeof(double));
+        for (int ii = 0; ii < 9; ii++)
+            timer[i][ii] = 0.0;
+    }
+
+    double t_start = mclock();
+    serverEngine( job->target, A_1d, Q_1d, R_1d, s, m, n, timer);
+    double t = mclock() - t_start;
+
+    double norm = (job->verify == 1) ? othogonalityTest( Q_1d, m, n, s) : -1.0;
+    arenaRelease( mark );
+
+    msync( Q_1d, m*n*sizeof(double), MS_ASYNC);
+    msync( R_1d, n*n*sizeof(double), MS_ASYNC);
+    munmap( A_1d, m*n*sizeof(double));
+    munmap( Q_1d, m*n*sizeof(double));
+    munmap( R_1d, n*n*sizeof(double));
+
+    snprintf( reply, len, "OK %lld Q=%s R=%s engine=%s wall=%1.6f queued=%1.6f orth=%1.3e\n",
+              job->id, locQ, locR, serverEngineName(job->target), t, t_start - job->t_queued, norm);
+    return 1;
+}
+
+static void serverSend( ServerClient * c, const char * msg ){
+    if (c == NULL || c->fd < 0)
+        return;
+    long long len = strlen( msg ), sent = 0;
+    while (sent < len){
+        ssize_t k = send( c->fd, msg + sent, len - sent, MSG_NOSIGNAL);
+        if (k <= 0)
+            return;
+        sent += k;
+    }
+}
+
+static int compareJobs( const void * a, const void * b ){
+    const ServerJob * x = (const ServerJob*)a;
+    const ServerJob * y = (const ServerJob*)b;
+    if (x->target != y->target) return x->target - y->target;
+    if (x->m != y->m) return (x->m < y->m) ? -1 : 1;
+    if (x->n != y->n) return (x->n < y->n) ? -1 : 1;
+    return (x->id < y->id) ? -1 : 1;
+}
+
+// reply of a finished job goes to its client
+static void serverDone( ServerJob * job, const char * reply, void * arg ){
+    ServerClient * clients = (ServerClient*)arg;
+    printf("[SERVER] %s", reply);
+    fflush( stdout );
+    serverSend( job->client >= 0 ? &clients[job->client] : NULL, reply);
+}
+
+// sequential batch sorted by (target, m, n) or, with cores > 1, concurrent jobs on partitions of the cores
+// (always forked, also a single job: the server process must not start a runtime with a pool of all cores)
+static void serverRunBatch( ServerJob * queue, int nqueued, int cores, ServerClient * clients ){
+    char reply[1024];
+    if (cores > 1){
+        schedulerRun( queue, nqueued, cores, serverDone, clients);
+        return;
+    }
+    qsort( queue, nqueued, sizeof(ServerJob), compareJobs);
+    for (int q = 0; q < nqueued; q++){
+        serverRunJob( &queue[q], reply, sizeof(reply));
+        serverDone( &queue[q], reply, clients);
+    }
+}
+
+int cgsroServe( const char * socket_path, int cores ){
+    if (socket_path == NULL){
+        printf("usage: --serve <socket path> [cores]\n");
+        return 1;
+    }
+
+    int lfd = socket( AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    unlink( socket_path );
+    if (lfd < 0 || bind( lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen( lfd, SERVER_MAX_CLIENTS) != 0){
+        printf("[SERVER] cannot listen on %s\n", socket_path);
+        return 1;
+    }
+    signal( SIGPIPE, SIG_IGN );
+
+#ifdef _OPENACC
+    // warmup once for all jobs (not with the scheduler: a forked job sizes its own thread pool)
+    if (cores <= 1)
+        testacc();
+#endif
+    printf("[SERVER] listening on %s%s\n", socket_path, cores > 1 ? " (concurrent batches)" : "");
+    fflush( stdout );
+
+    ServerClient * clients = (ServerClient*)mallocChecked( SERVER_MAX_CLIENTS, 1, 1, sizeof(ServerClient));
+    ServerJob * queue = (ServerJob*)mallocChecked( SERVER_MAX_JOBS, 1, 1, sizeof(ServerJob));
+    for (int c = 0; c < SERVER_MAX_CLIENTS; c++)
+        clients[c].fd = -1;
+
+    int nqueued = 0, running = 1;
+    long long njobs = 0;
+    double busy = 0.0;
+    char reply[1024];
+
+    while (running){
+        struct pollfd pfd[SERVER_MAX_CLIENTS + 1];
+        pfd[0].fd = lfd;
+        pfd[0].events = POLLIN;
+        for (int c = 0; c < SERVER_MAX_CLIENTS; c++){
+            pfd[c+1].fd = clients[c].fd;
+            pfd[c+1].events = POLLIN;
+        }
+
+        // block while idle, only peek for more requests while jobs are queued
+        int ready = poll( pfd, SERVER_MAX_CLIENTS + 1, nqueued > 0 ? 0 : -1);
+
+        if (ready == 0){
+            // no more input: run the batch
+            double t = mclock();
+            serverRunBatch( queue, nqueued, cores, clients);
+            busy += mclock() - t;
+            nqueued = 0;
+            continue;
+        }
+        if (ready < 0)
+            continue;
+
+        if (pfd[0].revents & POLLIN){
+            int fd = accept( lfd, NULL, NULL);
+            int c = 0;
+            while (c < SERVER_MAX_CLIENTS && clients[c].fd >= 0)
+                c++;
+            if (c == SERVER_MAX_CLIENTS){
+                close( fd );
+            }
+            else if (fd >= 0){
+                clients[c].fd = fd;
+                clients[c].len = 0;
+            }
+        }
+
+        for (int c = 0; c < SERVER_MAX_CLIENTS; c++){
+            ServerClient * cl = &clients[c];
+            if (cl->fd < 0 || !(pfd[c+1].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ssize_t k = read( cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len);
+            if (k <= 0){
+                // queued jobs of a closed client are still run, their replies are dropped
+                for (int q = 0; q < nqueued; q++)
+                    if (queue[q].client == c)
+                        queue[q].client = -1;
+                close( cl->fd );
+                cl->fd = -1;
+                continue;
+            }
+            cl->len += k;
+            cl->buf[cl->len] = '\0';
+
+            // handle all complete lines
+            char * line = cl->buf;
+            char * eol;
+            while ((eol = strchr( line, '\n')) != NULL){
+                *eol = '\0';
+                if (strncmp( line, "QR ", 3) == 0){
+                    // a steady stream of requests never lets poll return 0: a full queue is run right away
+                    if (nqueued == SERVER_MAX_JOBS){
+                        double t = mclock();
+                        serverRunBatch( queue, nqueued, cores, clients);
+                        busy += mclock() - t;
+                        nqueued = 0;
+                    }
+                    ServerJob * job = &queue[nqueued];
+                    char err[256];
+                    if (!serverParseRequest( line, job, err, sizeof(err))){
+                        snprintf( reply, sizeof(reply), "ERR %s\n", err);
+                        serverSend( cl, reply);
+                    }
+                    else {
+                        job->id = ++njobs;
+                        job->client = c;
+                        job->t_queued = mclock();
+                        nqueued++;
+                    }
+                }
+                else if (strncmp( line, "STATS", 5) == 0){
+                    snprintf( reply, sizeof(reply), "OK jobs=%lld queued=%d busy=%1.3f\n", njobs, nqueued, busy);
+                    serverSend( cl, reply);
+                }
+                else if (strncmp( line, "SHUTDOWN", 8) == 0){
+                    serverSend( cl, "OK bye\n");
+                    running = 0;
+                }
+                else if (line[0] != '\0'){
+                    serverSend( cl, "ERR unknown request\n");
+                }
+                line = eol + 1;
+            }
+            cl->len -= (int)(line - cl->buf);
+            memmove( cl->buf, line, cl->len);
+            if (cl->len == (int)sizeof(cl->buf) - 1){
+                serverSend( cl, "ERR request too long\n");
+                cl->len = 0;
+            }
+        }
+    }
+
+    // queued jobs are still served before the shutdown
+    double t = mclock();
+    serverRunBatch( queue, nqueued, cores, clients);
+    busy += mclock() - t;
+
+    for (int c = 0; c < SERVER_MAX_CLIENTS; c++)
+        if (clients[c].fd >= 0)
+            close( clients[c].fd );
+    close( lfd );
+    unlink( socket_path );
+    free( clients );
+    free( queue );
+
+    printf("[SERVER] %lld jobs served, busy %1.3f s\n", njobs, busy);
+    arenaReport();
+    return 0;
+}
+
+int cgsroAttach( const char * name ){
+    ShmHeader * h = (name != NULL) ? shmAttach( name ) : NULL;
+    if (h == NULL){
+        printf("[SHM] cannot attach %s\n", name != NULL ? name : "(null)");
+        return 1;
+    }
+    long long m = h->m, n = h->n;
+    int inplace = (h->offsetQ == SHM_HEADER_BYTES);
+    printf("[SHM] attached %s: %lld x %lld%s\n", name, m, n, inplace ? ", in place" : "");
+    fflush( stdout );
+
+#ifdef _OPENACC
+    testacc();
+#endif
+
+    // one job per SHM_READY until the producer closes the region
+    while (shmWait( h, SHM_READY, SHM_CLOSE) == SHM_READY){
+        int s = h->ro_steps;
+        if (s < 1 || s > 8 || strcmp( serverEngineName(h->target), "unknown") == 0 || (inplace && h->target != 1)){
+            h->status = 1;
+            shmSignal( h, SHM_DONE);
+            continue;
+        }
+        shmSignal( h, SHM_BUSY);
+
+        ArenaMark mark = arenaMark();
+        double ** timer = (double**)arenaAlloc( s, 1, 1, sizeof(double*));
+        for (int i = 0; i < s; i++)
+            timer[i] = (double*)arenaAlloc( 9, 1, 1, sizeof(double));
+
+        // the O(m*n^2) test only if the producer asks for it, it delays SHM_DONE
+        double t = mclock();
+        serverEngine( h->target, shmA(h), shmQ(h), NULL, s, m, n, timer);
+        h->wall = mclock() - t;
+        h->norm = (h->verify == 1) ? othogonalityTest( shmQ(h), m, n, s) : -1.0;
+        h->status = 0;
+        h->jobs++;
+        arenaRelease( mark );
+
+        printf("[SHM] job %lld: engine=%s ro_steps=%d wall=%1.6f orth=%1.3e\n", h->jobs, serverEngineName(h->target), s, h->wall, h->norm);
+        fflush( stdout );
+        shmSignal( h, SHM_DONE);
+    }
+
+    printf("[SHM] %s closed after %lld jobs\n", name, h->jobs);
+    shmDetach( h );
+    arenaReport();
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_server.h : a job server which accepts factorization requests over a Unix-domain socket
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// maximal number of connected clients and of queued jobs
+#define SERVER_MAX_CLIENTS 64
+#define SERVER_MAX_JOBS    256
+
+// a queued QR request
+struct ServerJob {
+    long long id;
+    int client;                 // index of the client which waits for the reply (-1 if it disconnected)
+    long long m, n;
+    int ro_steps, target;
+    int verify;                 // 1 - NormInf(I-Q^T*Q) is computed (optional verify token), -1 is reported otherwise
+    char input[256];            // path of a file or shm:/name (raw column-major doubles)
+    char output[256];           // prefix of Q and R (files or shm objects)
+    double t_queued;
+};
+
+const char * serverEngineName( int target );
+void serverEngine( int target, double * A_1d, double * Q_1d, double * R_1d, int s, long long m, long long n, double ** timer );
+int  serverParseRequest( const char * line, ServerJob * job, char * err, size_t len );
+int  serverRunJob( ServerJob * job, char * reply, size_t len );
+int  cgsroServe( const char * socket_path, int cores );
+int  cgsroAttach( const char * name );
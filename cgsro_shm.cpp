@@ -0,0 +1,135 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_shm.cpp : a shared-memory region which hands A and Q between a producer process and the solver without copies
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// A producer creates a POSIX shared-memory object (shm_open) holding a header, A and Q, writes A in place
+// and moves the state to SHM_READY. The solver (./cgsro --attach /name, cgsroAttach in cgsro_server.cpp)
+// maps the same object, orthogonalizes A straight into Q and moves the state to SHM_DONE.
+// State changes wake the other side through a futex on the state word of the shared mapping,
+// so neither side copies the m x n data. With inplace = 1 Q overwrites A (multicore CGS-RO).
+
+#include "helpers.h"
+#include "cgsro_shm.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "sys/syscall.h"
+#include "linux/futex.h"
+
+long long shmRegionBytes( long long m, long long n, int inplace ){
+    long long page = 4096;
+    long long bytesA = (m*n*(long long)sizeof(double) + page - 1) / page * page;
+    return SHM_HEADER_BYTES + (inplace ? 1 : 2) * bytesA;
+}
+
+ShmHeader * shmCreate( const char * name, long long m, long long n, int inplace ){
+    long long bytes = shmRegionBytes( m, n, inplace);
+    int fd = shm_open( name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return NULL;
+    if (ftruncate( fd, bytes) != 0){
+        close( fd );
+        return NULL;
+    }
+    void * p = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close( fd );
+    if (p == MAP_FAILED)
+        return NULL;
+
+    ShmHeader * h = (ShmHeader*)p;
+    memcpy( h->magic, "CGSROSHM", 8);
+    h->m = m;
+    h->n = n;
+    h->bytes = bytes;
+    h->offsetQ = inplace ? SHM_HEADER_BYTES : SHM_HEADER_BYTES + (bytes - SHM_HEADER_BYTES) / 2;
+    h->ro_steps = 1;
+    h->target = 1;
+    h->status = 0;
+    h->verify = 0;
+    h->jobs = 0;
+    h->wall = 0.0;
+    h->norm = -1.0;
+    shmSignal( h, SHM_EMPTY);
+    return h;
+}
+
+ShmHeader * shmAttach( const char * name ){
+    int fd = shm_open( name, O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+
+    // the solver trusts m, n and offsetQ of the header only if A and Q fit into the region
+    struct stat st;
+    ShmHeader hdr;
+    if (fstat( fd, &st) != 0 || st.st_size < SHM_HEADER_BYTES || pread( fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)
+        || memcmp( hdr.magic, "CGSROSHM", 8) != 0 || hdr.bytes > st.st_size 
+        || hdr.n < 1 || hdr.n > hdr.m || hdr.m > (1LL << 40) / hdr.n
+        || (hdr.offsetQ != SHM_HEADER_BYTES && hdr.offsetQ != SHM_HEADER_BYTES + (shmRegionBytes( hdr.m, hdr.n, 0) - SHM_HEADER_BYTES) / 2)
+        || shmRegionBytes( hdr.m, hdr.n, hdr.offsetQ == SHM_HEADER_BYTES) > hdr.bytes){
+        close( fd );
+        return NULL;
+    }
+    void * p = mmap( NULL, hdr.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close( fd );
+    return (p == MAP_FAILED) ? NULL : (ShmHeader*)p;
+}
+
+void shmDetach( ShmHeader * h ){
+    munmap( h, h->bytes);
+}
+
+double * shmA( ShmHeader * h ){
+    return (double*)((char*)h + SHM_HEADER_BYTES);
+}
+
+double * shmQ( ShmHeader * h ){
+    return (double*)((char*)h + h->offsetQ);
+}
+
+void shmSignal( ShmHeader * h, int state ){
+    __atomic_store_n( &h->state, state, __ATOMIC_RELEASE);
+    syscall( SYS_futex, &h->state, FUTEX_WAKE, 1 << 30, NULL, NULL, 0);
+}
+
+// waits until the state is state1 or state2, returns the state
+int shmWait( ShmHeader * h, int state1, int state2 ){
+    while (1){
+        int s = __atomic_load_n( &h->state, __ATOMIC_ACQUIRE);
+        if (s == state1 || s == state2)
+            return s;
+        // sleeps only while the word still holds s (no lost wake-up)
+        syscall( SYS_futex, &h->state, FUTEX_WAIT, s, NULL, NULL, 0);
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_shm.h : a shared-memory region which hands A and Q between a producer process and the solver without copies
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// states of a region (the futex word)
+#define SHM_EMPTY 0             // created, A is being written by the producer
+#define SHM_READY 1             // A is complete, the solver may start
+#define SHM_BUSY  2             // the solver orthogonalizes
+#define SHM_DONE  3             // Q is complete
+#define SHM_CLOSE 4             // the solver detaches
+
+#define SHM_HEADER_BYTES 4096   // A starts on a page boundary
+
+// header of a region (followed by A and, if not in place, Q; both column-major m x n doubles)
+struct ShmHeader {
+    char magic[8];              // "CGSROSHM"
+    long long m, n;
+    long long offsetQ;          // offset of Q in bytes (offset of A if the region is orthogonalized in place)
+    long long bytes;            // size of the region
+    int ro_steps, target;       // set by the producer before SHM_READY
+    int state;                  // futex word
+    int status;                 // 0 - ok, otherwise the job was rejected
+    int verify;                 // set by the producer: 1 - NormInf(I-Q^T*Q) is computed before SHM_DONE
+    long long jobs;             // number of jobs done on the region
+    double wall, norm;          // time of the last job and its NormInf(I-Q^T*Q)
+};
+
+long long shmRegionBytes( long long m, long long n, int inplace );
+ShmHeader * shmCreate( const char * name, long long m, long long n, int inplace );
+ShmHeader * shmAttach( const char * name );
+void shmDetach( ShmHeader * h );
+double * shmA( ShmHeader * h );
+double * shmQ( ShmHeader * h );
+void shmSignal( ShmHeader * h, int state );
+int  shmWait( ShmHeader * h, int state1, int state2 );
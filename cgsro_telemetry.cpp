@@ -0,0 +1,230 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_telemetry.cpp : live telemetry of the column loops (counters in a shared-memory page and a Prometheus textfile)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// The column loops of the sequential, multicore and GPU CGS-RO call telemetryColumn(j, ...) after each column.
+// It only adds to counters owned by the solving thread and stores them to the page with relaxed atomic stores 
+// (no locks, no read-modify-write on shared lines, no system calls). A publisher thread wakes every period seconds,
+// derives GB/s from the bytes streamed since its last wake-up and, if a textfile is set, rewrites it atomically
+// (write + rename) for the textfile collector of the Prometheus node exporter. A monitor reads the page at any time:
+//   ./cgsro_client monitor /cgsro_telemetry
+
+#include "helpers.h"
+#include "cgsro_telemetry.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "signal.h"
+#include "pthread.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+static TelemetryPage * tele = NULL;     // NULL - telemetry off
+static TelemetryPage tele_private;      // the page if only the textfile is published
+static char tele_shm[256] = "";
+static char tele_textfile[4096] = "";
+static double tele_period = 1.0;
+static pthread_t tele_publisher;
+static volatile int tele_stop = 0;
+
+// counters of the solving thread, mirrored to the page
+static long long tele_columns = 0, tele_passes = 0, tele_bytes = 0;
+
+static void telemetryWriteTextfile( TelemetryPage * p ){
+    char tmp[4096+8];
+    snprintf( tmp, sizeof(tmp), "%s.tmp", tele_textfile);
+    FILE * f = fopen( tmp, "w");
+    if (f == NULL)
+        return;
+    fprintf( f, "# HELP cgsro_columns_done Columns of Q finished by the current run.\n# TYPE cgsro_columns_done gauge\n");
+    fprintf( f, "cgsro_columns_done{engine=\"%s\"} %lld\n", p->engine, __atomic_load_n( &p->columns, __ATOMIC_RELAXED));
+    fprintf( f, "# HELP cgsro_columns_total Columns of A of the current run.\n# TYPE cgsro_columns_total gauge\n");
+    fprintf( f, "cgsro_columns_total{engine=\"%s\"} %lld\n", p->engine, p->n);
+    fprintf( f, "# HELP cgsro_passes_done Projection passes done by the current run.\n# TYPE cgsro_passes_done gauge\n");
+    fprintf( f, "cgsro_passes_done{engine=\"%s\"} %lld\n", p->engine, __atomic_load_n( &p->passes, __ATOMIC_RELAXED));
+    fprintf( f, "# HELP cgsro_bytes_streamed Bytes of A, Q and v streamed by the current run.\n# TYPE cgsro_bytes_streamed gauge\n");
+    fprintf( f, "cgsro_bytes_streamed{engine=\"%s\"} %lld\n", p->engine, __atomic_load_n( &p->bytes, __ATOMIC_RELAXED));
+    fprintf( f, "# HELP cgsro_gbps Streamed GB/s over the last period.\n# TYPE cgsro_gbps gauge\n");
+    fprintf( f, "cgsro_gbps{engine=\"%s\"} %1.3f\n", p->engine, p->gbps);
+    fprintf( f, "# HELP cgsro_running 1 while an engine is in its column loop.\n# TYPE cgsro_running gauge\n");
+    fprintf( f, "cgsro_running %d\n", __atomic_load_n( &p->running, __ATOMIC_RELAXED));
+    fprintf( f, "# HELP cgsro_runs_total Engines started by the solver.\n# TYPE cgsro_runs_total counter\n");
+    fprintf( f, "cgsro_runs_total %lld\n", p->runs);
+    fclose( f );
+    rename( tmp, tele_textfile);
+}
+
+static void * telemetryPublisher( void * arg ){
+    TelemetryPage * p = (TelemetryPage*)arg;
+    long long runs = -1, bytes = 0;
+    double t = mclock();
+    while (!tele_stop){
+        usleep( (useconds_t)(tele_period * 1e6) );
+        long long r = __atomic_load_n( &p->runs, __ATOMIC_ACQUIRE);
+        long long b = __atomic_load_n( &p->bytes, __ATOMIC_RELAXED);
+        double now = mclock();
+        if (r != runs){
+            bytes = 0;          // a new run restarts the counters
+            if (p->started > t)
+                t = p->started;
+        }
+        p->gbps = __atomic_load_n( &p->running, __ATOMIC_RELAXED) ? (b - bytes) / (now - t) / 1e9 : 0.0;
+        p->updated = now;
+        runs = r;
+        bytes = b;
+        t = now;
+        if (tele_textfile[0] != '\0')
+            telemetryWriteTextfile( p );
+    }
+    return NULL;
+}
+
+static void telemetryExit(){
+    if (tele == NULL || tele->pid != getpid())
+        return;                 // a forked child does not own the publisher
+    tele_stop = 1;
+    pthread_join( tele_publisher, NULL);
+    if (tele_textfile[0] != '\0')
+        telemetryWriteTextfile( tele );
+    if (tele != &tele_private){
+        munmap( tele, TELEMETRY_PAGE_BYTES);
+        shm_unlink( tele_shm );
+    }
+    tele = NULL;
+}
+
+// shm_name (e.g. /cgsro_telemetry) and/or textfile (e.g. /var/lib/node_exporter/cgsro.prom), NULL - not published
+void setTelemetry( const char * shm_name, const char * textfile, double period ){
+    if (tele != NULL || ((shm_name == NULL || shm_name[0] == '\0') && (textfile == NULL || textfile[0] == '\0')))
+        return;
+    snprintf( tele_shm, sizeof(tele_shm), "%s", shm_name != NULL ? shm_name : "");
+    snprintf( tele_textfile, sizeof(tele_textfile), "%s", textfile != NULL ? textfile : "");
+    tele_period = period > 0.0 ? period : 1.0;
+
+    TelemetryPage * p = &tele_private;
+    if (tele_shm[0] != '\0'){
+        int fd = shm_open( tele_shm, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        void * q = MAP_FAILED;
+        if (fd >= 0 && ftruncate( fd, TELEMETRY_PAGE_BYTES) == 0)
+            q = mmap( NULL, TELEMETRY_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (fd >= 0)
+            close( fd );
+        if (q == MAP_FAILED)
+            printf("[TELEMETRY] cannot create %s: not published\n", tele_shm);
+        else
+            p = (TelemetryPage*)q;
+    }
+    memset( p, 0, sizeof(TelemetryPage));
+    memcpy( p->magic, "CGSROTLM", 8);
+    p->pid = getpid();
+    snprintf( p->engine, sizeof(p->engine), "none");
+    tele = p;
+
+    tele_stop = 0;
+    pthread_create( &tele_publisher, NULL, telemetryPublisher, p);
+    atexit( telemetryExit );
+}
+
+void telemetryBegin( const char * engine, long long m, long long n, int ro_steps ){
+    TelemetryPage * p = tele;
+    if (p == NULL)
+        return;
+    tele_columns = tele_passes = tele_bytes = 0;
+    __atomic_store_n( &p->running, 0, __ATOMIC_RELAXED);
+    snprintf( p->engine, sizeof(p->engine), "%s", engine);
+    p->m = m;
+    p->n = n;
+    p->ro_steps = ro_steps;
+    p->started = mclock();
+    __atomic_store_n( &p->columns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n( &p->passes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n( &p->bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n( &p->running, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch( &p->runs, 1, __ATOMIC_RELEASE);
+}
+
+// column j is done: each of the ro_steps passes streams the j columns of Q twice (dot and update) and v, 
+// plus aj read and the column of Q written (m elements of size bytes each)
+void telemetryColumn( long long j, int ro_steps, long long m, size_t size ){
+    TelemetryPage * p = tele;
+    if (p == NULL)
+        return;
+    tele_columns = j + 1;
+    tele_passes += ro_steps;
+    tele_bytes += ((2*j + 2) * ro_steps + 2) * m * (long long)size;
+    __atomic_store_n( &p->columns, tele_columns, __ATOMIC_RELAXED);
+    __atomic_store_n( &p->passes, tele_passes, __ATOMIC_RELAXED);
+    __atomic_store_n( &p->bytes, tele_bytes, __ATOMIC_RELAXED);
+}
+
+void telemetryEnd(){
+    if (tele != NULL)
+        __atomic_store_n( &tele->running, 0, __ATOMIC_RELAXED);
+}
+
+TelemetryPage * telemetryAttach( const char * shm_name ){
+    int fd = shm_open( shm_name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    void * p = mmap( NULL, TELEMETRY_PAGE_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    close( fd );
+    if (p == MAP_FAILED || memcmp( ((TelemetryPage*)p)->magic, "CGSROTLM", 8) != 0)
+        return NULL;
+    return (TelemetryPage*)p;
+}
+
+// prints the page every period seconds until the solver exits
+int telemetryMonitor( const char * shm_name, double period ){
+    TelemetryPage * p = NULL;
+    while ((p = telemetryAttach( shm_name )) == NULL){
+        printf("[TELEMETRY] waiting for %s\n", shm_name);
+        fflush( stdout );
+        sleep( 1 );
+    }
+    printf("[TELEMETRY] %s: solver pid %lld\n", shm_name, p->pid);
+    while (kill( (pid_t)p->pid, 0) == 0){
+        long long c = __atomic_load_n( &p->columns, __ATOMIC_RELAXED);
+        long long n = p->n;
+        if (__atomic_load_n( &p->running, __ATOMIC_RELAXED))
+            printf("[TELEMETRY] %-12s [%lld x %lld, s = %lld] column %lld/%lld (%3.0f%%), passes = %lld, streamed = %1.2f GB, %1.2f GB/s\n",
+                   p->engine, p->m, n, p->ro_steps, c, n, n > 0 ? 100.0*c/n : 0.0, 
+                   __atomic_load_n( &p->passes, __ATOMIC_RELAXED), __atomic_load_n( &p->bytes, __ATOMIC_RELAXED)/1e9, p->gbps);
+        else
+            printf("[TELEMETRY] idle (runs = %lld)\n", p->runs);
+        fflush( stdout );
+        usleep( (useconds_t)(period * 1e6) );
+    }
+    printf("[TELEMETRY] solver %lld exited\n", p->pid);
+    munmap( p, TELEMETRY_PAGE_BYTES);
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_telemetry.h : live telemetry of the column loops (counters in a shared-memory page and a Prometheus textfile)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+#define TELEMETRY_PAGE_BYTES 4096
+
+// the shared-memory page (written by the solver, read by monitors at any time)
+struct TelemetryPage {
+    char magic[8];              // "CGSROTLM"
+    long long pid;              // of the solver
+    char engine[32];            // engine of the current (or last) run
+    long long m, n, ro_steps;
+    long long runs;             // engines started so far
+    int running;                // 1 while an engine is in its column loop
+    long long columns;          // columns done by the current run
+    long long passes;           // projection passes done (ro_steps per column)
+    long long bytes;            // bytes of A, Q and v streamed (model: see telemetryColumn)
+    double started;             // start of the current run (mclock)
+    double updated;             // last publication (mclock)
+    double gbps;                // streamed GB/s over the last period
+};
+
+void setTelemetry( const char * shm_name, const char * textfile, double period );
+void telemetryBegin( const char * engine, long long m, long long n, int ro_steps );
+void telemetryColumn( long long j, int ro_steps, long long m, size_t size );
+void telemetryEnd();
+TelemetryPage * telemetryAttach( const char * shm_name );
+int  telemetryMonitor( const char * shm_name, double period );
@@ -0,0 +1,274 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_tsqr.cpp : this function incudes a communication-avoiding tall-skinny QR (TSQR) with a binary reduction tree for a CPU (OpenACC multicore)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// TSQR in three stages:
+//  1. each of nblocks row-blocks of A is factored independently (Householder QR, explicit Q_b and R_b),
+//  2. R factors are combined in a binary tree: [R_b; R_b+h] = Q_node * R (log2(nblocks) levels),
+//  3. Q is reconstructed explicitly top-down: Q_b = Q_b * Q_node(top or bottom half) * ... * Q_root.
+// Contrary to CGS-RO there is no global reduction per column, only log2(nblocks) small n x n steps.
+
+#include "helpers.h"
+#include "cgsro_tsqr.h"
+
+// Householder QR of a (rows x n) block with leading dimension ld (rows >= n) overwritten by explicit Q,
+// upper triangular R (n x n, leading dimension ldr) is returned separately. 
+// Based on LAPACK dgeqr2 (factorization) and dorg2r (explicit Q).
+#pragma acc routine seq
+template <typename T>
+void householderQR_explicit( T * A, long long rows, long long ld, long long n, T * R, long long ldr, T * tau ){
+
+    long long k, c, i;
+
+    // factorization: A = H_0 * H_1 * ... * H_n-1 * R 
+    for ( k = 0; k < n; k++){
+        T alpha = A[k + k*ld];
+        T xnorm = 0.0;
+        for ( i = k+1; i < rows; i++)
+            xnorm += A[i + k*ld] * A[i + k*ld];
+
+        if (xnorm == 0.0){
+            tau[k] = 0.0;
+        }
+        else{
+            T beta = sqrt(alpha*alpha + xnorm);
+            if (alpha > 0.0)
+                beta = -beta;
+            tau[k] = (beta - alpha)/beta;
+            T scal = 1.0/(alpha - beta);
+            for ( i = k+1; i < rows; i++)
+                A[i + k*ld] *= scal;
+            A[k + k*ld] = beta;
+        }
+
+        // apply H_k = I - tau*v*v^T, v = [1; A(k+1:rows,k)] to trailing columns 
+        for ( c = k+1; c < n; c++){
+            T w = A[k + c*ld];
+            for ( i = k+1; i < rows; i++)
+                w += A[i + k*ld] * A[i + c*ld];
+            w *= tau[k];
+            A[k + c*ld] -= w;
+            for ( i = k+1; i < rows; i++)
+                A[i + c*ld] -= w * A[i + k*ld];
+        }
+    }
+
+    for ( c = 0; c < n; c++)
+        for ( i = 0; i < n; i++)
+            R[i + c*ldr] = (i <= c) ? A[i + c*ld] : 0.0;
+
+    // explicit Q: apply reflectors in reverse order to first n columns of identity
+    for ( k = n-1; k >= 0; k--){
+        if (k < n-1){
+            for ( c = k+1; c < n; c++){
+                T w = A[k + c*ld];
+                for ( i = k+1; i < rows; i++)
+                    w += A[i + k*ld] * A[i + c*ld];
+                w *= tau[k];
+                A[k + c*ld] -= w;
+                for ( i = k+1; i < rows; i++)
+                    A[i + c*ld] -= w * A[i + k*ld];
+            }
+        }
+        for ( i = k+1; i < rows; i++)
+            A[i + k*ld] *= -tau[k];
+        A[k + k*ld] = 1.0 - tau[k];
+        for ( i = 0; i < k; i++)
+            A[i + k*ld] = 0.0;
+    }
+}
+
+// B (rows x n, leading dimension ld) = B * M (n x n) in place, row by row (work: n entries)
+#pragma acc routine seq
+template <typename T>
+void multiplyBlockInPlace( T * B, long long rows, long long ld, long long n, T * M, T * work ){
+    for (long long i = 0; i < rows; i++){
+        for (long long c = 0; c < n; c++){
+            T tmp = 0.0;
+            for (long long l = 0; l < n; l++)
+                tmp += B[i + l*ld] * M[l + c*n];
+            work[c] = tmp;
+        }
+        for (long long c = 0; c < n; c++)
+            B[i + c*ld] = work[c];
+    }
+}
+
+// number of row-blocks: power of two not greater than requested, every block must have at least n rows
+int tsqrBlocks( int nblocks, long long m, long long n ){
+    int p = 1;
+    while ( 2*p <= nblocks && m/(2*p) >= n )
+        p *= 2;
+    return p;
+}
+
+template <typename T>
+void cgsro_tsqr( T * A_1d, T * Q_1d, int nblocks, long long m, long long n, int s, double ** timer, T * Rout_1d ){
+
+    double timer_tmp;
+    for(int ii = 0; ii < 9; ii++){
+        timer[s-1][ii] = 0.0;
+    }
+
+    double time_cgs = mclock();
+    timer_tmp = mclock();
+
+    int P = tsqrBlocks( nblocks, m, n);
+    long long mb = m / P; // rows in block, the last one takes the remainder
+
+    int levels = 0;
+    while ( (1 << levels) < P )
+        levels++;
+
+    long long nn = n*n;
+
+    // R of every block (R of the tree node is stored at the position of its left child)
+    ArenaMark mark = arenaMark();
+    T * R_1d    = (T*)arenaAlloc(nn, P, 1, sizeof(T));
+    // explicit Q (2n x n) of every tree node: level l has P/2^(l+1) nodes
+    T * Qtree_1d = (T*)arenaAlloc(2*nn, P > 1 ? P-1 : 1, 1, sizeof(T));
+    // product of tree Q factors on the way from the root to the node
+    T * M_1d    = (T*)arenaAlloc(nn, P, 1, sizeof(T));
+    T * work_1d = (T*)arenaAlloc(2*n, P, 1, sizeof(T));
+
+    int * level_offset = (int*)arenaAlloc(levels+1, 1, 1, sizeof(int));
+    level_offset[0] = 0;
+    for (long long l = 0; l < levels; l++)
+        level_offset[l+1] = level_offset[l] + (P >> (l+1));
+
+    #pragma acc parallel loop
+    for (long long row = 0; row < m; row++)
+        for (long long j = 0; j < n; j++)
+            Q_1d[row + j*m] = A_1d[row + j*m];
+
+    timer[s-1][0] += mclock() - timer_tmp;
+
+    // 1. local Householder QR of every row-block: Q_b overwrites rows of Q_1d 
+    timer_tmp = mclock();
+    #pragma acc parallel loop gang
+    for (long long b = 0; b < P; b++){
+        long long rows = (b == P-1) ? m - b*mb : mb;
+        householderQR_explicit( &Q_1d[b*mb], rows, m, n, &R_1d[b*nn], n, &work_1d[2*b*n]);
+    }
+    timer[s-1][3] += mclock() - timer_tmp;
+
+    // 2. binary reduction tree of R factors
+    timer_tmp = mclock();
+    for (long long l = 0; l < levels; l++){
+        int h = 1 << l;
+        int nodes = P >> (l+1);
+        #pragma acc parallel loop gang
+        for (long long nd = 0; nd < nodes; nd++){
+            long long left  = nd*2*h;
+            long long right = left + h;
+            T * Qn = &Qtree_1d[2*nn*(level_offset[l] + nd)];
+            for (long long c = 0; c < n; c++){
+                for (long long i = 0; i < n; i++){
+                    Qn[i     + c*2*n] = R_1d[left *nn + i + c*n];
+                    Qn[i + n + c*2*n] = R_1d[right*nn + i + c*n];
+                }
+            }
+            householderQR_explicit( Qn, 2*n, 2*n, n, &R_1d[left*nn], n, &work_1d[2*left*n]);
+        }
+    }
+    timer[s-1][4] += mclock() - timer_tmp;
+
+    // 3. explicit Q: top-down product of tree factors, then applied to local Q_b
+    timer_tmp = mclock();
+
+    // signs are chosen so that diag(R) > 0 (the same Q as in CGS-RO)
+    for (long long c = 0; c < n; c++)
+        for (long long i = 0; i < n; i++)
+            M_1d[i + c*n] = (i == c) ? (R_1d[c + c*n] < 0.0 ? -1.0 : 1.0) : 0.0;
+
+    // R of the root with the same signs (A = Q*R) if requested
+    if (Rout_1d != NULL){
+        for (long long c = 0; c < n; c++)
+            for (long long i = 0; i < n; i++)
+                Rout_1d[i + c*n] = (i <= c) ? M_1d[i + i*n] * R_1d[i + c*n] : 0.0;
+    }
+
+    for (long long l = levels-1; l >= 0; l--){
+        int h = 1 << l;
+        int nodes = P >> (l+1);
+        #pragma acc parallel loop gang
+        for (long long nd = 0; nd < nodes; nd++){
+            long long left  = nd*2*h;
+            long long right = left + h;
+            T * Qn = &Qtree_1d[2*nn*(level_offset[l] + nd)];
+            for (long long c = 0; c < n; c++){
+                for (long long i = 0; i < n; i++){
+                    T tl = 0.0, tr = 0.0;
+                    for (long long k = 0; k < n; k++){
+                        tl += Qn[i     + k*2*n] * M_1d[left*nn + k + c*n];
+                        tr += Qn[i + n + k*2*n] * M_1d[left*nn + k + c*n];
+                    }
+                    work_1d[2*left*n + i] = tl;
+                    M_1d[right*nn + i + c*n] = tr;
+                }
+                for (long long i = 0; i < n; i++)
+                    M_1d[left*nn + i + c*n] = work_1d[2*left*n + i];
+            }
+        }
+    }
+
+    #pragma acc parallel loop gang
+    for (long long b = 0; b < P; b++){
+        long long rows = (b == P-1) ? m - b*mb : mb;
+        multiplyBlockInPlace( &Q_1d[b*mb], rows, m, n, &M_1d[b*nn], &work_1d[2*b*n]);
+    }
+    timer[s-1][5] += mclock() - timer_tmp;
+
+    timer_tmp = mclock();
+    arenaRelease(mark);
+    timer[s-1][0] += mclock() - timer_tmp;
+
+    time_cgs = mclock() - time_cgs;
+
+    double time_loop = 0.0;
+    for(int ii = 0; ii < 7; ii++){
+        time_loop += timer[s-1][ii];
+    }
+    timer[s-1][8] = time_loop;
+
+    printf("[TSQR] row-blocks = %d, tree levels = %d\n", P, levels);
+    printf("[TSQR] PHASE                sec. [ %% ] \n"  );
+    printf("[TSQR] 1. init           = %1.3f [%3.1f ] \n", timer[s-1][0], 100.0*timer[s-1][0] / time_cgs );
+    printf("[TSQR] 2. local QR       = %1.3f [%3.1f ] \n", timer[s-1][3], 100.0*timer[s-1][3] / time_cgs );
+    printf("[TSQR] 3. R tree         = %1.3f [%3.1f ] \n", timer[s-1][4], 100.0*timer[s-1][4] / time_cgs );
+    printf("[TSQR] 4. Q              = %1.3f [%3.1f ] \n", timer[s-1][5], 100.0*timer[s-1][5] / time_cgs );
+    printf("[TSQR] 1-4 TSQR          = %1.3f [%3.1f ] \n", timer[s-1][8], 100.0*timer[s-1][8] / time_cgs );
+}
+
+template void cgsro_tsqr( float * A_1d, float * Q_1d, int nblocks, long long m, long long n, int s, double ** timer, float * Rout_1d );
+template void cgsro_tsqr( double * A_1d, double * Q_1d, int nblocks, long long m, long long n, int s, double ** timer, double * Rout_1d );
+template void cgsro_tsqr( long double * A_1d, long double * Q_1d, int nblocks, long long m, long long n, int s, double ** timer, long double * Rout_1d );
@@ -0,0 +1,9 @@
+#pragma acc routine seq
+template <typename T>
+void householderQR_explicit( T * A, long long rows, long long ld, long long n, T * R, long long ldr, T * tau );
+#pragma acc routine seq
+template <typename T>
+void multiplyBlockInPlace( T * B, long long rows, long long ld, long long n, T * M, T * work );
+int  tsqrBlocks( int nblocks, long long m, long long n );
+template <typename T>
+void cgsro_tsqr( T * A_1d, T * Q_1d, int nblocks, long long m, long long n, int s, double ** timer, T * Rout_1d = NULL );
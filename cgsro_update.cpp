@@ -0,0 +1,183 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_update.cpp : QR update and downdate: insertion and deletion of a column of A (CGS-RO and Givens rotations)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Q (m x n) and R (n x n, column-major, leading dimension ldr) are the QR of A. Instead of a new factorization:
+//   cgsro_insert_column(...)  - QR of A with a inserted as column p: a is orthogonalized against Q (cgsro_append, 
+//                               ro_steps passes) and stored as column n of Q, its coefficients become column p of R
+//                               (the later columns of R move right). R is then upper triangular but for column p, 
+//                               whose entries below the diagonal are zeroed by Givens rotations of rows n..p+1 of R,
+//                               negative R(i, i) are then flipped with column i of Q (diag(R) > 0).
+//                               Q needs room for n+1 columns and R for n+1 rows and columns.
+//   cgsro_delete_column(...)  - QR of A without column p: column p is removed from R (the later columns move left), 
+//                               which leaves one entry below the diagonal in columns p..n-2, zeroed by Givens rotations 
+//                               of rows p..n-1. Column n-1 of Q and row and column n-1 of R are zeroed.
+// The same rotations are applied to the columns of Q (Q*G^T) in one sweep over the rows of Q (parallel over rows),
+// so an update costs O(m*n) for the orthogonalization and O(m*(n-p)) for the rotations instead of O(m*n^2).
+
+#include "helpers.h"
+#include "cgsro_multicore.h"
+#include "cgsro_update.h"
+
+// c, s such that [c s; -s c] * [x; y] = [h; 0], h = sqrt(x^2 + y^2) >= 0
+template <typename T>
+static void givens( T x, T y, T * c, T * s ){
+    T h = sqrt( x*x + y*y );
+    if (h == 0.0){
+        *c = 1.0;
+        *s = 0.0;
+        return;
+    }
+    *c = x/h;
+    *s = y/h;
+}
+
+// Q = Q*G_0^T*G_1^T*...: rotation t acts on the columns col[t] and col[t]+1 of Q
+template <typename T>
+static void rotateColumns( T * Q_1d, long long m, long long * col, T * c, T * s, long long count ){
+    #pragma acc parallel loop
+    for ( long long row = 0; row < m; row++){
+        for ( long long t = 0; t < count; t++){
+            T q0 = Q_1d[row + col[t]*m];
+            T q1 = Q_1d[row + (col[t]+1)*m];
+            Q_1d[row + col[t]*m]     =  c[t]*q0 + s[t]*q1;
+            Q_1d[row + (col[t]+1)*m] = -s[t]*q0 + c[t]*q1;
+        }
+    }
+}
+
+// rows i and i+1 of R, columns j0..j1-1
+template <typename T>
+static void rotateRows( T * R_1d, long long ldr, long long i, long long j0, long long j1, T c, T s ){
+    for ( long long j = j0; j < j1; j++){
+        T r0 = R_1d[i + j*ldr];
+        T r1 = R_1d[i + 1 + j*ldr];
+        R_1d[i + j*ldr]     =  c*r0 + s*r1;
+        R_1d[i + 1 + j*ldr] = -s*r0 + c*r1;
+    }
+}
+
+template <typename T>
+void cgsro_insert_column( T * Q_1d, T * R_1d, long long ldr, T * a, int ro_steps, long long m, long long n, long long p ){
+
+    ArenaMark mark = arenaMark();
+    T * r = (T*)arenaAlloc(n+1, 1, 1, sizeof(T));
+    T * c = (T*)arenaAlloc(n+1, 1, 1, sizeof(T));
+    T * s = (T*)arenaAlloc(n+1, 1, 1, sizeof(T));
+    long long * col = (long long*)arenaAlloc(n+1, 1, 1, sizeof(long long));
+
+    // Q = [Q q], [Q q]*r = a
+    cgsro_append( Q_1d, a, r, ro_steps, m, n);
+
+    // R = [R(:,0:p-1) r R(:,p:n-1)], row n is zero but in column p
+    for ( long long j = n-1; j >= p; j--){
+        for ( long long i = 0; i < n; i++)
+            R_1d[i + (j+1)*ldr] = R_1d[i + j*ldr];
+    }
+    for ( long long j = 0; j <= n; j++)
+        R_1d[n + j*ldr] = 0.0;
+    for ( long long i = 0; i <= n; i++)
+        R_1d[i + p*ldr] = r[i];
+
+    // zero R(n..p+1, p) from the bottom, the rotation of rows i-1, i fills R(i, i) only
+    long long count = 0;
+    for ( long long i = n; i > p; i--){
+        givens( R_1d[i-1 + p*ldr], R_1d[i + p*ldr], &c[count], &s[count]);
+        rotateRows( R_1d, ldr, i-1, p, n+1, c[count], s[count]);
+        R_1d[i + p*ldr] = 0.0;
+        col[count] = i-1;
+        count++;
+    }
+    rotateColumns( Q_1d, m, col, c, s, count);
+
+    // the rotations leave R(i, i) = -s*R(i-1, i) for i > p, which may be negative: such rows of R and columns of Q
+    // change sign, so diag(R) > 0 as in a refactorization
+    long long nflip = 0;
+    for ( long long i = p; i <= n; i++){
+        if (R_1d[i + i*ldr] < 0.0){
+            for ( long long j = i; j <= n; j++)
+                R_1d[i + j*ldr] = -R_1d[i + j*ldr];
+            col[nflip++] = i;
+        }
+    }
+    #pragma acc parallel loop
+    for ( long long row = 0; row < m; row++){
+        for ( long long t = 0; t < nflip; t++)
+            Q_1d[row + col[t]*m] = -Q_1d[row + col[t]*m];
+    }
+
+    arenaRelease(mark);
+}
+
+template <typename T>
+void cgsro_delete_column( T * Q_1d, T * R_1d, long long ldr, long long m, long long n, long long p ){
+
+    ArenaMark mark = arenaMark();
+    T * c = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+    T * s = (T*)arenaAlloc(n, 1, 1, sizeof(T));
+    long long * col = (long long*)arenaAlloc(n, 1, 1, sizeof(long long));
+
+    // R = [R(:,0:p-1) R(:,p+1:n-1)], n x (n-1) with R(j+1, j) != 0 for j >= p
+    for ( long long j = p; j < n-1; j++){
+        for ( long long i = 0; i < n; i++)
+            R_1d[i + j*ldr] = R_1d[i + (j+1)*ldr];
+    }
+
+    long long count = 0;
+    for ( long long j = p; j < n-1; j++){
+        givens( R_1d[j + j*ldr], R_1d[j+1 + j*ldr], &c[count], &s[count]);
+        rotateRows( R_1d, ldr, j, j, n-1, c[count], s[count]);
+        R_1d[j+1 + j*ldr] = 0.0;
+        col[count] = j;
+        count++;
+    }
+    rotateColumns( Q_1d, m, col, c, s, count);
+
+    // Q is m x (n-1), R (n-1) x (n-1)
+    #pragma acc parallel loop
+    for ( long long row = 0; row < m; row++)
+        Q_1d[row + (n-1)*m] = 0.0;
+    for ( long long i = 0; i < n; i++){
+        R_1d[n-1 + i*ldr] = 0.0;
+        R_1d[i + (n-1)*ldr] = 0.0;
+    }
+
+    arenaRelease(mark);
+}
+
+template void cgsro_insert_column( float * Q_1d, float * R_1d, long long ldr, float * a, int ro_steps, long long m, long long n, long long p );
+template void cgsro_insert_column( double * Q_1d, double * R_1d, long long ldr, double * a, int ro_steps, long long m, long long n, long long p );
+template void cgsro_insert_column( long double * Q_1d, long double * R_1d, long long ldr, long double * a, int ro_steps, long long m, long long n, long long p );
+
+template void cgsro_delete_column( float * Q_1d, float * R_1d, long long ldr, long long m, long long n, long long p );
+template void cgsro_delete_column( double * Q_1d, double * R_1d, long long ldr, long long m, long long n, long long p );
+template void cgsro_delete_column( long double * Q_1d, long double * R_1d, long long ldr, long long m, long long n, long long p );
@@ -0,0 +1,230 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_verifier.cpp : loss of orthogonality test overlapped with the column loop (verifier threads on finished panels of Q)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// Column j of Q is final once the column loop has passed it, so the entries (k, j), k <= j, of I - Q^T*Q can be
+// checked while later columns are computed. Between verifierBegin(...) and verifierEnd(...) a group of threads 
+// takes work items: a panel of VERIFIER_PANEL finished columns j against a block of VERIFIER_KBLOCK columns k <= j.
+// A work item sweeps Q in VERIFIER_ROWS row chunks and keeps one accumulator per (k, j), so every dot is summed 
+// over rows in the order of checkLossOfOrthogonality (helpers.cpp) and the result equals othogonalityTest exactly.
+// The column loop (cgsro_multicore) calls verifierColumn(j+1) after each column: it publishes the number of
+// finished columns, wakes the verifiers when a panel is complete and returns 1 once an entry exceeds the 
+// threshold, then the engine stops. Only the last panel is left for the tail after the last column.
+
+#include "helpers.h"
+#include "cgsro_verifier.h"
+
+#include "pthread.h"
+
+#define VERIFIER_MAX_THREADS 64
+
+struct Verifier {
+    void * Q;
+    long long m, n;
+    double threshold;
+    int threads;
+    long long done;             // finished columns of Q (published by the engine)
+    int finished;               // the engine has returned
+    int abort;                  // an entry exceeded the threshold
+    long long abortColumn;
+    double maxEntry;            // max |I - Q^T*Q| over the checked entries
+    long long panel, kblock;    // next work item
+    double (*item)( Verifier * v, long long c0, long long c1, long long k0, long long k1 );
+    pthread_t th[VERIFIER_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static Verifier * verifier = NULL;
+
+// max |I - Q^T*Q| over k0 <= k < k1, c0 <= j < c1, k <= j
+template <typename T>
+static double verifierItem( Verifier * v, long long c0, long long c1, long long k0, long long k1 ){
+    T * Q = (T*)v->Q;
+    long long m = v->m;
+    T acc[VERIFIER_KBLOCK][VERIFIER_PANEL];
+
+    for (long long k = k0; k < k1; k++)
+        for (long long j = c0; j < c1; j++)
+            acc[k-k0][j-c0] = 0.0;
+
+    for (long long r0 = 0; r0 < m; r0 += VERIFIER_ROWS){
+        long long r1 = (r0 + VERIFIER_ROWS < m) ? r0 + VERIFIER_ROWS : m;
+        for (long long k = k0; k < k1; k++){
+            for (long long j = (k > c0 ? k : c0); j < c1; j++){
+                T tmp = acc[k-k0][j-c0];
+                for (long long row = r0; row < r1; row++)
+                    tmp += Q[row + k*m] * Q[row + j*m];
+                acc[k-k0][j-c0] = tmp;
+            }
+        }
+    }
+
+    double max = 0.0;
+    for (long long k = k0; k < k1; k++){
+        for (long long j = (k > c0 ? k : c0); j < c1; j++){
+            T e = (T)(k == j ? 1.0 : 0.0) - acc[k-k0][j-c0];
+            double a = (double)(e < 0 ? -e : e);
+            if (a > max)
+                max = a;
+        }
+    }
+    return max;
+}
+
+static void * verifierThread( void * arg ){
+    Verifier * v = (Verifier*)arg;
+
+    pthread_mutex_lock( &v->lock );
+    while (1){
+        // the next panel is ready once all its columns are done (or the engine has returned)
+        long long c0 = v->panel * VERIFIER_PANEL;
+        long long c1 = (c0 + VERIFIER_PANEL < v->n) ? c0 + VERIFIER_PANEL : v->n;
+        long long done = __atomic_load_n( &v->done, __ATOMIC_ACQUIRE);
+        if (v->abort || c0 >= v->n || (v->finished && c0 >= done))
+            break;
+        if (done < c1 && !v->finished){
+            pthread_cond_wait( &v->cond, &v->lock );
+            continue;
+        }
+        if (c1 > done)
+            c1 = done;
+
+        long long k0 = v->kblock * VERIFIER_KBLOCK;
+        long long k1 = (k0 + VERIFIER_KBLOCK < c1) ? k0 + VERIFIER_KBLOCK : c1;
+        if (k1 >= c1){
+            v->panel++;
+            v->kblock = 0;
+        }
+        else
+            v->kblock++;
+        pthread_mutex_unlock( &v->lock );
+
+        double max = v->item( v, c0, c1, k0, k1);
+
+        pthread_mutex_lock( &v->lock );
+        if (max > v->maxEntry)
+            v->maxEntry = max;
+        if (max > v->threshold && !v->abort){
+            v->abortColumn = c0;
+            __atomic_store_n( &v->abort, 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock( &v->lock );
+    return NULL;
+}
+
+template <typename T>
+void verifierBegin( T * Q_1d, long long m, long long n, int threads, double threshold ){
+    if (verifier != NULL)
+        return;
+    Verifier * v = new Verifier;
+    v->Q = Q_1d;
+    v->m = m;
+    v->n = n;
+    v->threshold = threshold;
+    v->threads = (threads < 1) ? 1 : (threads > VERIFIER_MAX_THREADS ? VERIFIER_MAX_THREADS : threads);
+    v->done = 0;
+    v->finished = 0;
+    v->abort = 0;
+    v->abortColumn = -1;
+    v->maxEntry = 0.0;
+    v->panel = v->kblock = 0;
+    v->item = verifierItem<T>;
+    pthread_mutex_init( &v->lock, NULL);
+    pthread_cond_init( &v->cond, NULL);
+    for (int t = 0; t < v->threads; t++)
+        pthread_create( &v->th[t], NULL, verifierThread, v);
+    verifier = v;
+}
+
+// columns 0..done-1 of Q are final; returns 1 if the run should stop
+int verifierColumn( long long done ){
+    Verifier * v = verifier;
+    if (v == NULL)
+        return 0;
+
+    long long prev = __atomic_exchange_n( &v->done, done, __ATOMIC_RELEASE);
+    if (prev / VERIFIER_PANEL != done / VERIFIER_PANEL || done == v->n){
+        pthread_mutex_lock( &v->lock );
+        pthread_cond_broadcast( &v->cond );
+        pthread_mutex_unlock( &v->lock );
+    }
+    return __atomic_load_n( &v->abort, __ATOMIC_ACQUIRE);
+}
+
+// first column of the panel which exceeded the threshold, -1 unless the run is aborted
+long long verifierAbortColumn(){
+    Verifier * v = verifier;
+    if (v == NULL || !__atomic_load_n( &v->abort, __ATOMIC_ACQUIRE))
+        return -1;
+    return v->abortColumn;
+}
+
+// waits for the verifiers, prints and returns max |I - Q^T*Q| (as othogonalityTest), -1 if no verifier is active;
+// aborted (if given) is the number of columns done before the run was aborted, -1 if it was not
+double verifierEnd( int s, long long * aborted ){
+    Verifier * v = verifier;
+    if (aborted != NULL)
+        *aborted = -1;
+    if (v == NULL)
+        return -1.0;
+
+    double t_end = mclock();
+    pthread_mutex_lock( &v->lock );
+    v->finished = 1;
+    pthread_cond_broadcast( &v->cond );
+    pthread_mutex_unlock( &v->lock );
+    for (int t = 0; t < v->threads; t++)
+        pthread_join( v->th[t], NULL);
+    double tail = mclock() - t_end;
+
+    if (v->abort)
+        printf("[CGS-RO][re-ortho #%d] NormInf(I-Q^T*Q) >= %1.3e > %1.1e in columns %lld..%lld: run aborted after %lld columns\n", 
+               s, v->maxEntry, v->threshold, v->abortColumn, v->abortColumn + VERIFIER_PANEL - 1, v->done);
+    else
+        printf("[CGS-RO][re-ortho #%d] NormInf(I-Q^T*Q) = %1.3e [overlapped, %d threads, TIME after the last column: %1.3f s]\n", 
+               s, v->maxEntry, v->threads, tail);
+    double norm = v->maxEntry;
+    if (aborted != NULL && v->abort)
+        *aborted = v->done;
+
+    pthread_mutex_destroy( &v->lock );
+    pthread_cond_destroy( &v->cond );
+    delete v;
+    verifier = NULL;
+    return norm;
+}
+
+template void verifierBegin( float * Q_1d, long long m, long long n, int threads, double threshold );
+template void verifierBegin( double * Q_1d, long long m, long long n, int threads, double threshold );
+template void verifierBegin( long double * Q_1d, long long m, long long n, int threads, double threshold );
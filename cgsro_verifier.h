@@ -0,0 +1,42 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of cgsro_verifier.h : loss of orthogonality test overlapped with the column loop (verifier threads on finished panels of Q)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+#define VERIFIER_PANEL  16      // columns of Q checked together (rows of I - Q^T*Q)
+#define VERIFIER_KBLOCK 64      // columns of Q against which one work item checks a panel
+#define VERIFIER_ROWS   1024    // rows of Q per sweep of a work item (the panel stays in cache)
+
+template <typename T>
+void   verifierBegin( T * Q_1d, long long m, long long n, int threads, double threshold );
+int    verifierColumn( long long done );
+long long verifierAbortColumn();
+double verifierEnd( int s, long long * aborted = NULL );
@@ -1,6 +1,8 @@
 rm *.o
 rm cgsro_multicore
 rm cgsro_tesla
+rm cgsro_client
+rm libparallelcgs.so
 #rm cgsro_tesla_p100
 
 # IMPORTANT:
@@ -8,20 +10,80 @@ rm cgsro_tesla
 # 2. Make sure that CUDA_PATH is defined properly 
 
 # CPU: target = multicore
-pgc++ -o cgsro_multicore     -fast -acc -ta=multicore  main.cpp  cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp
+pgc++ -o cgsro_multicore     -fast -acc -ta=multicore  main.cpp  cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lpthread
+
+# CPU: target = multicore, projection step (r = Q^T*v, v = v - Q*r) also routed through CBLAS (compared with native loops in the same run):
+#pgc++ -o cgsro_multicore_openblas -fast -acc -ta=multicore -DCGSRO_CBLAS main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lopenblas -lpthread
+#pgc++ -o cgsro_multicore_blis     -fast -acc -ta=multicore -DCGSRO_CBLAS main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lblis -lpthread
+#pgc++ -o cgsro_multicore_mkl      -fast -acc -ta=multicore -DCGSRO_CBLAS -DCGSRO_MKL main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lmkl_rt -lpthread
+
+# CPU: target = multicore, distributed CGS-RO (target = 8) over MPI instead of the shared-memory stand-in (MPI built with pgc++):
+#mpic++ -o cgsro_mpi -fast -acc -ta=multicore -DCGSRO_MPI main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lpthread
+
+# client of the job server (./cgsro_* --serve <socket>):
+pgc++ -o cgsro_client -fast -acc -ta=multicore cgsro_client.cpp helpers.cpp cgsro_generator.cpp cgsro_shm.cpp cgsro_telemetry.cpp -lpthread
+
+# C library libparallelcgs.so (parallelcgs.h: pcgs_dgsqrf / pcgs_sgsqrf with leading dimensions, in place, workspace query):
+pgc++ -o libparallelcgs.so -shared -fPIC -fast -acc -ta=multicore cgsro_capi.cpp helpers.cpp
+
+# Python module (import cgsro), all sources but main.cpp:
+#pgc++ -o cgsro$(python3-config --extension-suffix) -shared -fPIC -fast -acc -ta=multicore $(python3-config --includes) cgsro_python.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lpthread
 
 # GPU: target = Tesla K40
-pgc++ -o cgsro_tesla     -g -w -fast -acc -ta=tesla:cc35,lineinfo -Minfo=accel,ccff -Mlarge_arrays  main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp 
+pgc++ -o cgsro_tesla     -g -w -fast -acc -ta=tesla:cc35,lineinfo -Minfo=accel,ccff -Mlarge_arrays  main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lpthread
 
 # GPU: target = Tesla P100
-#pgc++ -o cgsro_tesla_p100   -I./opt/pgi/linux86-64/2017/cuda/9.0/include -L/opt/pgi/linux86-64/2017/cuda/9.0/lib64 -lcudart  -g  -w -fast -acc -ta=tesla:cc60,lineinfo  -Minfo=accel,ccff -Mlarge_arrays  main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp  cgsro_multicore.cpp cgsro_gpu.cpp 
+#pgc++ -o cgsro_tesla_p100   -I./opt/pgi/linux86-64/2017/cuda/9.0/include -L/opt/pgi/linux86-64/2017/cuda/9.0/lib64 -lcudart  -g  -w -fast -acc -ta=tesla:cc60,lineinfo  -Minfo=accel,ccff -Mlarge_arrays  main.cpp cgsro.cpp helpers.cpp cgsro_sequential.cpp  cgsro_multicore.cpp cgsro_gpu.cpp cgsro_blas.cpp cgsro_tsqr.cpp cgsro_cholqr.cpp cgsro_rgs.cpp cgsro_mixed.cpp cgsro_complex.cpp cgsro_distributed.cpp cgsro_generator.cpp cgsro_refcache.cpp cgsro_checkpoint.cpp cgsro_telemetry.cpp cgsro_verifier.cpp cgsro_update.cpp cgsro_server.cpp cgsro_shm.cpp cgsro_scheduler.cpp -lpthread
 
 
 # How to run:
-#./cgsro_* rows cols ro_steps target
+#./cgsro_* rows cols ro_steps target [precision: 1 - float, 2 - double (default), 3 - long double] [family: 0 - initA_version1 (default), 1 - Gaussian, 2 - U*S*V^T, 3 - graded, 4 - Lauchli] [cond] [seed]
 
 # CPU (multicore): 
 #./cgsro_multicore 100000 100 1 1
 
+# CPU (multicore, TSQR compared with sequential CGS-RO):
+#./cgsro_multicore 10000000 64 1 3
+
+# CPU (multicore, CholeskyQR2 compared with sequential CGS-RO):
+#./cgsro_multicore 10000000 64 1 4
+
+# CPU (multicore, single precision):
+#./cgsro_multicore 100000 100 2 1 1
+
+# CPU (multicore, complex<double> CGS-RO compared with the 2x real embedding):
+#./cgsro_multicore 100000 100 2 7
+
+# CPU (distributed CGS-RO, 4 forked processes or, with cgsro_mpi, 8 MPI ranks):
+#./cgsro_multicore 1000000 100 2 8
+#mpirun -np 8 ./cgsro_mpi 1000000 100 2 8
+
+# CPU (multicore, U*S*V^T test matrix with cond = 1e10):
+#./cgsro_multicore 1000000 100 2 1 2 2 1e10
+
 # GPU (Tesla K40):
 #./cgsro_tesla 100000 100 1 2
+
+# Job server (warm engines and arena), a test matrix written by the client and two requests queued as one batch:
+#./cgsro_multicore --serve /tmp/cgsro.sock &
+#./cgsro_client gen /tmp/A.bin 100000 100 2 1e8
+#./cgsro_client /tmp/cgsro.sock "QR /tmp/A.bin 100000 100 2 1" "QR /tmp/A.bin 100000 100 1 4 /tmp/A_cholqr verify" STATS
+#./cgsro_client /tmp/cgsro.sock SHUTDOWN
+
+# Queue of jobs (one request of the job server per line) run concurrently on partitions of 64 cores; 
+# the job server runs its batches the same way with ./cgsro_multicore --serve /tmp/cgsro.sock 64:
+#./cgsro_multicore --schedule jobs.txt 64
+
+# Python (A must be Fortran-ordered float64):
+#python3 -c "import numpy as np, cgsro; A = np.asfortranarray(np.random.rand(100000, 100)); Q, R = cgsro.factor(A, 2); print(cgsro.orthogonality(Q))"
+#python3 -c "import numpy as np, cgsro; A = np.asfortranarray(np.random.rand(100000, 100)); Q, R = cgsro.factor(A, 2); Q, R = cgsro.delete_column(Q, R, 17); print(cgsro.orthogonality(Q))"
+
+# Zero-copy handoff: a producer writes A into a shared-memory region (3 jobs, orthogonalized in place), the solver attaches to it:
+#./cgsro_client shm /cgsro_A 1000000 100 2 1 3 1 1 &
+#./cgsro_multicore --attach /cgsro_A
+
+# Live progress of a long run (useTelemetry = 1 in run_cgsro) from another shell, refreshed every 2 s:
+#./cgsro_client monitor /cgsro_telemetry 2
+
+# Rank-revealing CGS-RO (rankRevealing = 1 in run_cgsro) of a U*S*V^T matrix with cond = 1e20:
+#./cgsro_multicore 20000 100 2 1 2 2 1e20
@@ -43,14 +43,223 @@ double mclock(){
     return sec + usec;
 }
 
-double ** allocMatrix (  int m, int n) {
+// n1*n2*n3*size, the program stops on negative sizes or overflow
+size_t checkedBytes( long long n1, long long n2, long long n3, size_t size){
+
+    if (n1 < 0 || n2 < 0 || n3 < 0){
+        printf("[CGS-RO] allocation failed: negative size %lld x %lld x %lld\n", n1, n2, n3);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t bytes = size;
+    long long dims[3] = {n1, n2, n3};
+    for (int d = 0; d < 3; d++){
+        if (dims[d] != 0 && bytes > SIZE_MAX / (size_t)dims[d]){
+            printf("[CGS-RO] allocation failed: %lld x %lld x %lld x %zu bytes overflows size_t\n", n1, n2, n3, size);
+            exit(EXIT_FAILURE);
+        }
+        bytes *= (size_t)dims[d];
+    }
+    return bytes;
+}
+
+void * mallocChecked( long long n1, long long n2, long long n3, size_t size){
+
+    size_t bytes = checkedBytes( n1, n2, n3, size);
+
+    void * ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL){
+        printf("[CGS-RO] allocation failed: %zu bytes are not available\n", bytes);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// Workspace arena: chunks of at least ARENA_CHUNK bytes, 2 MB aligned and backed by huge pages (MAP_HUGETLB if 
+// huge pages are reserved, transparent huge pages otherwise). Memory is never returned to the system, chunks are 
+// reused by the next calls. Allocations are released in the stack order with arenaMark()/arenaRelease().
+// Every thread has its own arena (thread_local), so engines may run in several threads at once (Python module,
+// libparallelcgs.so) without sharing buffers or releasing each other's allocations.
+#define ARENA_ALIGN      64
+#define ARENA_HUGE_PAGE  (2LL*1024*1024)
+#define ARENA_CHUNK      (64LL*1024*1024)
+#define ARENA_MAX_CHUNKS 256
+
+struct ArenaChunk {
+    char * base;
+    long long bytes;
+    long long used;
+    int hugetlb;
+};
+
+// state of the arena of one thread, the chunks are unmapped when the thread exits
+struct ArenaState {
+    ArenaChunk chunk[ARENA_MAX_CHUNKS];
+    int nchunks;
+    int current;
+    long long in_use;
+    long long high_water;
+    long long mapped;
+
+    ~ArenaState(){
+        for (int c = 0; c < nchunks; c++)
+            munmap( chunk[c].base, chunk[c].bytes);
+    }
+};
+
+static thread_local ArenaState arena;
+
+static int arenaMapChunk( long long bytes ){
+
+    if (arena.nchunks == ARENA_MAX_CHUNKS){
+        printf("[ARENA] allocation failed: more than %d chunks\n", ARENA_MAX_CHUNKS);
+        exit(EXIT_FAILURE);
+    }
+    bytes = (bytes + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+
+    ArenaChunk * c = &arena.chunk[arena.nchunks];
+    c->bytes = bytes;
+    c->used = 0;
+    c->hugetlb = 1;
+    c->base = (char*)mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (c->base == MAP_FAILED){
+        // no reserved huge pages: 2 MB aligned anonymous memory with transparent huge pages
+        c->hugetlb = 0;
+        char * raw = (char*)mmap( NULL, bytes + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED){
+            printf("[ARENA] allocation failed: %lld bytes are not available\n", bytes);
+            exit(EXIT_FAILURE);
+        }
+        char * base = (char*)(((uintptr_t)raw + ARENA_HUGE_PAGE - 1) & ~(uintptr_t)(ARENA_HUGE_PAGE - 1));
+        if (base > raw)
+            munmap( raw, base - raw);
+        if (base + bytes < raw + bytes + ARENA_HUGE_PAGE)
+            munmap( base + bytes, (raw + bytes + ARENA_HUGE_PAGE) - (base + bytes));
+        madvise( base, bytes, MADV_HUGEPAGE);
+        c->base = base;
+    }
+    arena.mapped += bytes;
+    return arena.nchunks++;
+}
+
+void * arenaAlloc( long long n1, long long n2, long long n3, size_t size){
+
+    long long bytes = (long long)checkedBytes( n1, n2, n3, size);
+    bytes = (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (bytes == 0)
+        bytes = ARENA_ALIGN;
+
+    if (arena.nchunks == 0)
+        arenaMapChunk( bytes > ARENA_CHUNK ? bytes : ARENA_CHUNK);
+
+    // current chunk, then the next (empty) chunk which is large enough, then a new chunk
+    int c = arena.current;
+    if (arena.chunk[c].used + bytes > arena.chunk[c].bytes){
+        for (c = arena.current + 1; c < arena.nchunks; c++)
+            if (arena.chunk[c].bytes >= bytes)
+                break;
+        if (c == arena.nchunks)
+            c = arenaMapChunk( bytes > ARENA_CHUNK ? bytes : ARENA_CHUNK);
+        arena.current = c;
+    }
+
+    void * ptr = arena.chunk[c].base + arena.chunk[c].used;
+    arena.chunk[c].used += bytes;
+    arena.in_use += bytes;
+    if (arena.in_use > arena.high_water)
+        arena.high_water = arena.in_use;
+    return ptr;
+}
+
+ArenaMark arenaMark(){
+    ArenaMark mark;
+    mark.chunk = arena.current;
+    mark.used  = arena.nchunks > 0 ? arena.chunk[arena.current].used : 0;
+    return mark;
+}
+
+void arenaRelease( ArenaMark mark ){
+    if (arena.nchunks == 0)
+        return;
+    for (int c = mark.chunk + 1; c <= arena.current; c++)
+        arena.chunk[c].used = 0;
+    arena.chunk[mark.chunk].used = mark.used;
+    arena.current = mark.chunk;
+
+    arena.in_use = 0;
+    for (int c = 0; c <= arena.current; c++)
+        arena.in_use += arena.chunk[c].used;
+}
+
+void arenaReport(){
+    int hugetlb = 0;
+    for (int c = 0; c < arena.nchunks; c++)
+        hugetlb += arena.chunk[c].hugetlb;
+    printf("[ARENA] high-water mark = %1.1f MB, mapped = %1.1f MB in %d chunks (%d MAP_HUGETLB, %d THP)\n",
+           arena.high_water/1048576.0, arena.mapped/1048576.0, arena.nchunks, hugetlb, arena.nchunks - hugetlb);
+}
+
+static int reproducible_reductions = 0;
+
+void setReproducibleReductions( int on ){
+    reproducible_reductions = on;
+}
+
+int getReproducibleReductions(){
+    return reproducible_reductions;
+}
+
+long long reproBlocks( long long m ){
+    return (m + REPRO_BLOCK - 1) / REPRO_BLOCK;
+}
+
+// partial[0] = sum of partial[0..nblocks-1], pairwise (the tree depends on nblocks only)
+template <typename T>
+T reproCombine( T * partial, long long nblocks ){
+    for (long long stride = 1; stride < nblocks; stride *= 2)
+        for (long long b = 0; b + stride < nblocks; b += 2*stride)
+            partial[b] += partial[b + stride];
+    return (nblocks > 0) ? partial[0] : (T)0.0;
+}
+
+template <typename T>
+T reproDot( T * x, T * y, long long m ){
+
+    long long nblocks = reproBlocks( m );
+    ArenaMark mark = arenaMark();
+    T * partial = (T*)arenaAlloc( nblocks, 1, 1, sizeof(T));
+
+    #pragma acc parallel loop
+    for (long long b = 0; b < nblocks; b++){
+        long long row0 = b*REPRO_BLOCK;
+        long long row1 = (row0 + REPRO_BLOCK < m) ? row0 + REPRO_BLOCK : m;
+        T s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        long long row = row0;
+        for ( ; row + 3 < row1; row += 4){
+            s0 += x[row]   * y[row];
+            s1 += x[row+1] * y[row+1];
+            s2 += x[row+2] * y[row+2];
+            s3 += x[row+3] * y[row+3];
+        }
+        for ( ; row < row1; row++)
+            s0 += x[row] * y[row];
+        partial[b] = (s0 + s1) + (s2 + s3);
+    }
+
+    T dot = reproCombine( partial, nblocks );
+    arenaRelease( mark );
+    return dot;
+}
+
+double ** allocMatrix (  long long m, long long n) {
 
     double ** A = new double*[m];
-    for(int i = 0; i < m; ++i)
+    for(long long i = 0; i < m; ++i)
         A[i] = new double[n];
     
-    for (int i = 0; i < m; i++){
-        for (int j = 0; j < n; j++){
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
             A[i][j] = 0.0;
         }
     }
@@ -59,18 +268,18 @@ double ** allocMatrix (  int m, int n) {
 
 }
 
-void printMatrix( double ** A, int m, int n){
+void printMatrix( double ** A, long long m, long long n){
     printf("\n");
-    for (int i = 0; i < m; i++){
-        for (int j = 0; j < n; j++){
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
             printf("%f ", A[i][j]);
         }
         printf("\n");
     }
 }
 
-void initA_version1( double ** A, int m, int n, double epsilon){
-    for (int j = 0; j < n; j++){
+void initA_version1( double ** A, long long m, long long n, double epsilon){
+    for (long long j = 0; j < n; j++){
         A[0][j]   = 1.0;
         if (m != n)
             A[j+1][j] = epsilon;
@@ -79,51 +288,133 @@ void initA_version1( double ** A, int m, int n, double epsilon){
     }
 }
 
-void initA_version2( double ** A, int m, int n){
-    for (int i = 0; i < m; i++){
-        for (int j = 0; j < n; j++){
+void initA_version2( double ** A, long long m, long long n){
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
             A[i][j] = 0.1 * rand()/rand();
         }
     }
 }
 
-void initI_1d( double * I_1d, int m, int n ){
+template <typename T>
+void transposeToColumnMajor( double ** A, T * A_1d, long long m, long long n){
+
+    long long tiles_i = (m + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    long long tiles_j = (n + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+
+    // a tile (64 rows x 64 columns) is read from 64 rows and written to 64 columns while it fits in L1
+    #pragma acc parallel loop collapse(2)
+    for (long long tj = 0; tj < tiles_j; tj++){
+        for (long long ti = 0; ti < tiles_i; ti++){
+            long long i0 = ti * TRANSPOSE_TILE, i1 = (i0 + TRANSPOSE_TILE < m) ? i0 + TRANSPOSE_TILE : m;
+            long long j0 = tj * TRANSPOSE_TILE, j1 = (j0 + TRANSPOSE_TILE < n) ? j0 + TRANSPOSE_TILE : n;
+            for (long long j = j0; j < j1; j++){
+                for (long long i = i0; i < i1; i++){
+                    A_1d[i + j*m] = (T)A[i][j];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+CscMatrix<T> * cscFromDense( T * A_1d, long long m, long long n){
+
+    CscMatrix<T> * C = new CscMatrix<T>;
+    C->m = m;
+    C->n = n;
+    C->colptr = (long long*)mallocChecked(n+1, 1, 1, sizeof(long long));
+
+    // columns are contiguous in A_1d: both sweeps run in parallel over columns
+    #pragma acc parallel loop
+    for (long long j = 0; j < n; j++){
+        long long nz = 0;
+        for (long long i = 0; i < m; i++)
+            if (A_1d[i + j*m] != 0.0)
+                nz++;
+        C->colptr[j+1] = nz;
+    }
+    C->colptr[0] = 0;
+    for (long long j = 0; j < n; j++)
+        C->colptr[j+1] += C->colptr[j];
+    C->nnz = C->colptr[n];
+    C->rowidx = (long long*)mallocChecked(C->nnz, 1, 1, sizeof(long long));
+    C->val    = (T*)mallocChecked(C->nnz, 1, 1, sizeof(T));
+
+    #pragma acc parallel loop
+    for (long long j = 0; j < n; j++){
+        long long p = C->colptr[j];
+        for (long long i = 0; i < m; i++){
+            if (A_1d[i + j*m] != 0.0){
+                C->rowidx[p] = i;
+                C->val[p]    = A_1d[i + j*m];
+                p++;
+            }
+        }
+    }
+    return C;
+}
+
+template <typename T>
+void cscFree( CscMatrix<T> * A ){
+    free(A->colptr); free(A->rowidx); free(A->val);
+    delete A;
+}
 
-    for (int j = 0; j < n*n; j++){
+template void transposeToColumnMajor( double ** A, float * A_1d, long long m, long long n);
+template void transposeToColumnMajor( double ** A, double * A_1d, long long m, long long n);
+template void transposeToColumnMajor( double ** A, long double * A_1d, long long m, long long n);
+template CscMatrix<float> *       cscFromDense( float * A_1d, long long m, long long n);
+template CscMatrix<double> *      cscFromDense( double * A_1d, long long m, long long n);
+template CscMatrix<long double> * cscFromDense( long double * A_1d, long long m, long long n);
+template void cscFree( CscMatrix<float> * A );
+template void cscFree( CscMatrix<double> * A );
+template void cscFree( CscMatrix<long double> * A );
+
+template <> const char * scalarTypeName<float>()       { return "float"; }
+template <> const char * scalarTypeName<double>()      { return "double"; }
+template <> const char * scalarTypeName<long double>() { return "long double"; }
+
+template <typename T>
+void initI_1d( T * I_1d, long long m, long long n ){
+
+    for (long long j = 0; j < n*n; j++){
         I_1d[j] = 0.0;
     }
 
-    for (int j = 0; j < n; j++){
+    for (long long j = 0; j < n; j++){
         I_1d[j*n+j] = 1.0;
     }
 }
-double normEq2( double ** A, int m, int n){
+double normEq2( double ** A, long long m, long long n){
 
     double nr = 0.0;
-    for (int i = 0; i < m; i++){
-        for (int j = 0; j < n; j++){
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
             nr += A[i][j] * A[i][j];
         }
     }
 
     return sqrt(nr);
 }
-double normEq2( double * a, int m){
+template <typename T>
+T normEq2( T * a, long long m){
 
-    double nr = 0.0;
-    for (int i = 0; i < m; i++){
+    T nr = 0.0;
+    for (long long i = 0; i < m; i++){
         nr += a[i] * a[i];
     }
 
     return sqrt(nr);
 }
 
-double normInf_1d( double * A, int m, int n){
+template <typename T>
+T normInf_1d( T * A, long long m, long long n){
 
-    double nr = 0.0;
-    double max = -1.0;
-    for (int i = 0; i < m; i++){
-        for (int j = 0; j < n; j++){
+    T nr = 0.0;
+    T max = -1.0;
+    for (long long i = 0; i < m; i++){
+        for (long long j = 0; j < n; j++){
             nr = abs(A[i*m+j]) ;
             if (nr > max)
                 max = nr;
@@ -133,63 +424,147 @@ double normInf_1d( double * A, int m, int n){
     return max;
 }
 
-void checkLossOfOrthogonality ( double * I_QtQ,  double * QtQ, double * I,  double * Q, int m, int n){
+template <typename T>
+void checkLossOfOrthogonality ( T * I_QtQ,  T * QtQ, T * I,  T * Q, long long m, long long n){
 
-    for(int i = 0; i < n; ++i)
-        for(int j = 0; j < n; ++j)
-            for(int k = 0; k < m; ++k) {
+    for(long long i = 0; i < n; ++i)
+        for(long long j = 0; j < n; ++j){
+            QtQ[i*n+j] = 0.0;
+            for(long long k = 0; k < m; ++k) {
                 QtQ[i*n+j] += Q[k+i*m] * Q[k+j*m];
             }
+        }
 
-    for (int i = 0; i < n ; i++){
-        for (int j = 0; j < n ; j++){
+    for (long long i = 0; i < n ; i++){
+        for (long long j = 0; j < n ; j++){
             I_QtQ[i*n+j] = I[i*n+j] - QtQ[i*n+j];
         }
     }
 }
 
 
-void othogonalityTest(double * Q_1d, int m, int n, int s ){
+template <typename T>
+double orthogonalityNorm(T * Q_1d, long long m, long long n ){
 
-    double time_orthotest = mclock();
-
-    double t1 = mclock();
-    
-    double * I_1d       = (double*)malloc(sizeof(double)*n*n); // square matrix: I
-    double * QtQ_1d     = (double*)malloc(sizeof(double)*n*n); // square matrix: Q^T*Q
-    double * I_QtQ_1d   = (double*)malloc(sizeof(double)*n*n); // square matrix: I - Q^T*Q
-    
-    double t2 = mclock();
+    ArenaMark mark = arenaMark();
+    T * I_1d       = (T*)arenaAlloc(n, n, 1, sizeof(T)); // square matrix: I
+    T * QtQ_1d     = (T*)arenaAlloc(n, n, 1, sizeof(T)); // square matrix: Q^T*Q
+    T * I_QtQ_1d   = (T*)arenaAlloc(n, n, 1, sizeof(T)); // square matrix: I - Q^T*Q
 
     initI_1d(I_1d, n, n);
-        
-    double t3 = mclock();
 
     checkLossOfOrthogonality (I_QtQ_1d, QtQ_1d, I_1d, Q_1d, m, n);
-    
-    double t4 = mclock();
 
-    double norm = normInf_1d(I_QtQ_1d, n, n);
+    double norm = (double)normInf_1d(I_QtQ_1d, n, n);
+
+    arenaRelease(mark);
+
+    return norm;
+}
+
+
+template <typename T>
+double othogonalityTest(T * Q_1d, long long m, long long n, int s ){
+
+    double time_orthotest = mclock();
+
+    double norm = orthogonalityNorm(Q_1d, m, n);
 
-    double t5 = mclock();
-    
     time_orthotest = mclock() - time_orthotest;
 
     printf("[CGS-RO][re-ortho #%d] NormInf(I-Q^T*Q) = %1.3e [TIME of LossOrthogonalityTest: %1.3f s]\n", s, norm , time_orthotest);
-    //printf("alloc = %2.2f s, init = %2.2f s, calc I-Q^T*Q = %2.2f s, calc normInf = %2.2f s\n", t2-t1, t3-t2, t4-t3, t5-t4 );
+
+    return norm;
 }
 
 
+template <typename T>
+void formR( T * Q_1d, T * A_1d, T * R_1d, long long m, long long n){
+
+    #pragma acc parallel loop collapse(2)
+    for (long long j = 0; j < n; j++){
+        for (long long i = 0; i < n; i++){
+            T tmp = 0.0;
+            if (i <= j){
+                for (long long k = 0; k < m; k++)
+                    tmp += Q_1d[k + i*m] * A_1d[k + j*m];
+            }
+            R_1d[i + j*n] = tmp;
+        }
+    }
+}
+
+template <typename R>
+void othogonalityTestComplex( std::complex<R> * Q_c, long long m, long long n, int s ){
+
+    double time_orthotest = mclock();
+
+    R * Q_1d = reinterpret_cast<R*>(Q_c);
+    R max = 0.0;
+
+    // entries of I - Q^H*Q, Q is kept in the interleaved (re, im) layout 
+    #pragma acc parallel loop collapse(2) reduction(max:max)
+    for (long long i = 0; i < n; i++){
+        for (long long j = 0; j < n; j++){
+            R re = 0.0, im = 0.0;
+            for (long long k = 0; k < m; k++){
+                R qr = Q_1d[2*(k+i*m)], qi = Q_1d[2*(k+i*m)+1];
+                R vr = Q_1d[2*(k+j*m)], vi = Q_1d[2*(k+j*m)+1];
+                re += qr*vr + qi*vi;
+                im += qr*vi - qi*vr;
+            }
+            re = (i == j ? 1.0 : 0.0) - re;
+            R nr = sqrt(re*re + im*im);
+            if (nr > max)
+                max = nr;
+        }
+    }
+
+    time_orthotest = mclock() - time_orthotest;
+
+    printf("[CGS-RO][re-ortho #%d] NormInf(I-Q^H*Q) = %1.3e [TIME of LossOrthogonalityTest: %1.3f s]\n", s, (double)max , time_orthotest);
+}
+
+
+template float       reproCombine( float * partial, long long nblocks );
+template double      reproCombine( double * partial, long long nblocks );
+template long double reproCombine( long double * partial, long long nblocks );
+template float       reproDot( float * x, float * y, long long m );
+template double      reproDot( double * x, double * y, long long m );
+template long double reproDot( long double * x, long double * y, long long m );
+template void initI_1d( float * I_1d, long long m, long long n );
+template void initI_1d( double * I_1d, long long m, long long n );
+template void initI_1d( long double * I_1d, long long m, long long n );
+template float       normEq2( float * a, long long m);
+template double      normEq2( double * a, long long m);
+template long double normEq2( long double * a, long long m);
+template float       normInf_1d( float * A, long long m, long long n);
+template double      normInf_1d( double * A, long long m, long long n);
+template long double normInf_1d( long double * A, long long m, long long n);
+template double orthogonalityNorm( float * Q_1d, long long m, long long n );
+template double orthogonalityNorm( double * Q_1d, long long m, long long n );
+template double orthogonalityNorm( long double * Q_1d, long long m, long long n );
+template double othogonalityTest( float * Q_1d, long long m, long long n, int s );
+template double othogonalityTest( double * Q_1d, long long m, long long n, int s );
+template double othogonalityTest( long double * Q_1d, long long m, long long n, int s );
+template void formR( float * Q_1d, float * A_1d, float * R_1d, long long m, long long n);
+template void formR( double * Q_1d, double * A_1d, double * R_1d, long long m, long long n);
+template void formR( long double * Q_1d, long double * A_1d, long double * R_1d, long long m, long long n);
+template void othogonalityTestComplex( std::complex<float> * Q_c, long long m, long long n, int s );
+template void othogonalityTestComplex( std::complex<double> * Q_c, long long m, long long n, int s );
+template void othogonalityTestComplex( std::complex<long double> * Q_c, long long m, long long n, int s );
+
+
 // Important: If needed computations from this function may also be parallelized with OpenACC
-void checkLossOfOrthogonality ( double ** I_QtQ,  double ** QtQ, double ** I,  double ** Q, int m, int n){
-    for(int i = 0; i < n; ++i)
-        for(int j = 0; j < n; ++j)
-            for(int k = 0; k < m; ++k) {
+void checkLossOfOrthogonality ( double ** I_QtQ,  double ** QtQ, double ** I,  double ** Q, long long m, long long n){
+    for(long long i = 0; i < n; ++i)
+        for(long long j = 0; j < n; ++j)
+            for(long long k = 0; k < m; ++k) {
                 QtQ[i][j] += Q[k][i] * Q[k][j];
             }
 
-    for (int i = 0; i < n ; i++){
-        for (int j = 0; j < n ; j++){
+    for (long long i = 0; i < n ; i++){
+        for (long long j = 0; j < n ; j++){
             I_QtQ[i][j] = I[i][j] - QtQ[i][j];
         }
     }
@@ -1,31 +1,104 @@
 #include "stdio.h"
 #include "stdlib.h"
+#include "stdint.h"
 
 #include "math.h"
+#include <complex>
 #include "sys/time.h"
+#include "sys/mman.h"
 
 #include "/opt/pgi/linux86-64/2017/cuda/9.0/include/cuda.h"
 #include "/opt/pgi/linux86-64/2017/cuda/9.0/include/cuComplex.h"
 
 double mclock();
 
-double ** allocMatrix (  int m, int n);
+// n1*n2*n3 elements of given size, the product is checked for overflow (program stops if allocation fails)
+void * mallocChecked( long long n1, long long n2, long long n3, size_t size);
+size_t checkedBytes( long long n1, long long n2, long long n3, size_t size);
 
-void printMatrix( double ** A, int m, int n);
+// workspace arena for scratch buffers of engines and helpers (64-byte aligned, huge pages, reused across calls):
+//     ArenaMark mark = arenaMark();  ... p = arenaAlloc(...) ...  arenaRelease(mark);
+struct ArenaMark {
+    int chunk;
+    long long used;
+};
+void * arenaAlloc( long long n1, long long n2, long long n3, size_t size);
+ArenaMark arenaMark();
+void arenaRelease( ArenaMark mark );
+void arenaReport();
 
-void initA_version1( double ** A, int m, int n, double epsilon);
-void initA_version2( double ** A, int m, int n);
+double ** allocMatrix (  long long m, long long n);
 
-void initI_1d( double * I, int m, int n );
+// reproducible reductions (the same bits for any number of threads): a sum over rows is split into fixed blocks
+// of REPRO_BLOCK rows (4 interleaved partial sums per block), block sums are combined pairwise in a fixed order
+#define REPRO_BLOCK 2048
+void setReproducibleReductions( int on );
+int  getReproducibleReductions();
+long long reproBlocks( long long m );
+template <typename T>
+T reproCombine( T * partial, long long nblocks );
+template <typename T>
+T reproDot( T * x, T * y, long long m );
 
-double normEq2( double ** A, int m, int n);
-double normEq2( double * a, int m);
+// row-major A (rows A[i]) -> column-major A_1d, in parallel over TRANSPOSE_TILE x TRANSPOSE_TILE tiles
+#define TRANSPOSE_TILE 64
+template <typename T>
+void transposeToColumnMajor( double ** A, T * A_1d, long long m, long long n);
 
-double normInf_1d( double * A, int m, int n);
+// sparse A (m x n) in the compressed sparse column format: rows and values of column j are 
+// rowidx[colptr[j] : colptr[j+1]-1] and val[colptr[j] : colptr[j+1]-1]
+template <typename T>
+struct CscMatrix {
+    long long m, n, nnz;
+    long long * colptr;
+    long long * rowidx;
+    T * val;
+};
 
-void othogonalityTest(double * , int , int , int );
+template <typename T>
+CscMatrix<T> * cscFromDense( T * A_1d, long long m, long long n);
+template <typename T>
+void cscFree( CscMatrix<T> * A );
 
-void checkLossOfOrthogonality ( double * I_QtQ,  double * QtQ, double * I,  double * Q, int m, int n);
+void printMatrix( double ** A, long long m, long long n);
+
+void initA_version1( double ** A, long long m, long long n, double epsilon);
+void initA_version2( double ** A, long long m, long long n);
+
+// name of the scalar type used in reports ("float", "double", "long double")
+template <typename T>
+const char * scalarTypeName();
+
+// accumulator type for sums whose cancellation decides stability (float is accumulated in double)
+template <typename T> struct Accumulator        { typedef T      type; };
+template <>           struct Accumulator<float> { typedef double type; };
+
+template <typename T>
+void initI_1d( T * I, long long m, long long n );
+
+double normEq2( double ** A, long long m, long long n);
+template <typename T>
+T normEq2( T * a, long long m);
+
+template <typename T>
+T normInf_1d( T * A, long long m, long long n);
+
+// R = Q^T*A (n x n, upper triangular, column-major)
+template <typename T>
+void formR( T * Q_1d, T * A_1d, T * R_1d, long long m, long long n);
+
+// returns NormInf(I-Q^T*Q) (orthogonalityNorm does not report)
+template <typename T>
+double orthogonalityNorm(T * , long long , long long );
+template <typename T>
+double othogonalityTest(T * , long long , long long , int );
+
+// complex Q: NormInf(I-Q^H*Q)
+template <typename R>
+void othogonalityTestComplex( std::complex<R> * Q_c, long long m, long long n, int s );
+
+template <typename T>
+void checkLossOfOrthogonality ( T * I_QtQ,  T * QtQ, T * I,  T * Q, long long m, long long n);
 
 
 
@@ -34,44 +34,125 @@
 #include "helpers.h"
 
 #include "cgsro.h"
+#include "cgsro_generator.h"
+#include "cgsro_server.h"
+#include "cgsro_scheduler.h"
+#include "cgsro_distributed.h"
+
+#include "string.h"
+
+#ifdef CGSRO_MPI
+#include "mpi.h"
+#endif
 
 int main( int argc, char* argv[]  ){
+    // daemon mode: ./cgsro --serve <socket path> [cores] (see cgsro_server.cpp)
+    if (argc > 1 && strcmp( argv[1], "--serve") == 0)
+        return cgsroServe( argc > 2 ? argv[2] : NULL, argc > 3 ? (int)strtol( argv[3], NULL, 10 ) : 1 );
+    // queue of jobs (requests of the job server, one per line) run concurrently: ./cgsro --schedule <jobfile> [cores]
+    if (argc > 1 && strcmp( argv[1], "--schedule") == 0)
+        return cgsroSchedule( argc > 2 ? argv[2] : NULL, argc > 3 ? (int)strtol( argv[3], NULL, 10 ) : 0 );
+    // solver of a shared-memory region of a producer: ./cgsro --attach /name (see cgsro_shm.cpp)
+    if (argc > 1 && strcmp( argv[1], "--attach") == 0)
+        return cgsroAttach( argc > 2 ? argv[2] : NULL );
+
+#ifdef CGSRO_MPI
+    // rank 0 runs the driver (A, Q, the reference and the tests), the other ranks only their row-blocks of target = 8
+    MPI_Init( &argc, &argv );
+    int rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+    if (rank != 0)
+        freopen( "/dev/null", "w", stdout );
+#endif
     printf( "\n\n\nParallelCGS: classical Gram-Schmidt with re-orthogonalization:\n" );
 
     // CGS setup:
     // m - number of rows
     // n - number of columns
     // ro_steps - number of reorthogonalization steps
-    // target - device which performs computations: 1 - CPU, 2 - GPU
-    int m, n, ro_steps, target;
+    // target - device which performs computations: 1 - CPU, 2 - GPU, 3 - CPU (TSQR instead of CGS-RO),
+    //                                                  4 - CPU (CholeskyQR2 / shifted CholeskyQR3 instead of CGS-RO),
+    //                                                  5 - CPU (randomized Gram-Schmidt instead of CGS-RO),
+    //                                                  6 - CPU (mixed-precision CGS-RO: float storage, double accumulation),
+    //                                                  7 - CPU (complex CGS-RO, compared with the 2x real embedding),
+    //                                                  8 - CPU (distributed CGS-RO: row-blocks on MPI ranks or forked processes)
+    // precision - scalar type of A and Q (optional): 1 - float, 2 - double, 3 - long double (not on a GPU)
+    // family, cond, seed - test matrix (optional): 0 - initA_version1 (default), 1..4 - generated (cgsro_generator.cpp) 
+    //                      with condition number cond and seed of the RNG
+    long long m, n;
+    int ro_steps, target, precision, family;
+    double cond;
+    unsigned long long seed;
    
     // default:
     m = 1000;
     n = 100;
     ro_steps  = 1;
     target = 2;
+    precision = 2;
+    family = 0;
+    cond = 1e6;
+    seed = 2018;
 
     // defined by user:
-    m = (int)strtol( argv[1], NULL, 10 );   
-    n = (int)strtol( argv[2], NULL, 10 );  
+    m = strtoll( argv[1], NULL, 10 );   
+    n = strtoll( argv[2], NULL, 10 );  
     ro_steps  = (int)strtol( argv[3], NULL, 10 );  
     target = (int)strtol( argv[4], NULL, 10 );  
+    if (argc > 5)
+        precision = (int)strtol( argv[5], NULL, 10 );
+    if (argc > 6)
+        family = (int)strtol( argv[6], NULL, 10 );
+    if (argc > 7)
+        cond = strtod( argv[7], NULL );
+    if (argc > 8)
+        seed = strtoull( argv[8], NULL, 10 );
+
+    printf("CGS setup >>> m(rows) = %lld, n(cols) = %lld, ro_steps = %d, target = %d, precision = %d\n", m, n, ro_steps, target, precision);
 
-    printf("CGS setup >>> m(rows) = %d, n(cols) = %d, ro_steps = %d, target = %d\n", m, n, ro_steps, target);
+    if (target == 2 && precision == 3){
+        printf("long double (precision = 3) is not supported on a GPU (target = 2)\n");
+#ifdef CGSRO_MPI
+        MPI_Finalize();
+#endif
+        return 1;
+    }
+
+#ifdef CGSRO_MPI
+    if (rank != 0){
+        if (target == 8)
+            cgsroDistributedWorker( m, n, ro_steps, precision );
+        MPI_Finalize();
+        return 0;
+    }
+#endif
 
     double ** A = allocMatrix ( m, n) ; // m x n
 
     // Matrix type #1
     double epsilon = 1e-3;
-    initA_version1(A, m, n, epsilon);
+    if (family == 0)
+        initA_version1(A, m, n, epsilon);
 
     // Matrix type #2
     //initA_version2(A, m, n);
 
+    // Matrix type #3 (parallel, reproducible)
+    if (family > 0){
+        double t_gen = mclock();
+        initA_generated(A, m, n, family, cond, seed);
+        t_gen = mclock() - t_gen;
+        printf("A: %s, cond = %1.1e, seed = %llu [TIME of generation: %1.3f s]\n", matrixFamilyName(family), cond, seed, t_gen);
+    }
+
     //printMatrix( A, m, n);
 
     // run classical Gram-Schmidt with re-orthogonalization due to the execution setup:
-    run_cgsro(m,n,ro_steps,target,A); 
+    run_cgsro(m,n,ro_steps,target,precision,A); 
+
+#ifdef CGSRO_MPI
+    MPI_Finalize();
+#endif
     
     return 0;
 }
@@ -0,0 +1,62 @@
+/*
+ Copyright (c) 2018 Gdańsk University of Technology
+ 
+ Unless otherwise indicated, Source Code is licensed under MIT license.
+ See further explanation attached in License Statement (distributed in the file LICENSE).
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+/***************************************************************************************
+ ParallelCGS: classical Gram-Schmidt with re-orthogonalization:
+ Content of parallelcgs.h : the C interface of libparallelcgs.so (LAPACK-style: leading dimensions, in place, workspace query)
+ Author: Adam Dziekonski
+ Generated August 2018
+***************************************************************************************/
+
+// A (m x n, m >= n) is column-major with the leading dimension lda. On return Q (ldq) holds the orthonormal
+// columns and R (ldr, n x n) the upper triangular factor, A = Q*R. Q == A (ldq == lda) overwrites A with Q,
+// so a sub-panel of a bigger matrix is factored in place: pcgs_dgsqrf(m, n, &B[i + j*ldb], ldb, &B[i + j*ldb], ldb, ...).
+// work holds lwork scalars; lwork = -1 is a query (the required lwork is returned in work[0]); work = NULL takes
+// the workspace from the internal arena. ro_steps is the number of CGS passes (2 - CGS-RO).
+// Returns 0, -k if the k-th argument is illegal or j > 0 if the column j (1-based) is numerically dependent on the previous
+// ones (the first such column; the factorization is completed but Q is not orthonormal).
+
+#define PCGS_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int pcgs_version( void );
+
+int pcgs_dgsqrf( long long m, long long n, const double * A, long long lda, double * Q, long long ldq,
+                 double * R, long long ldr, int ro_steps, double * work, long long lwork );
+int pcgs_sgsqrf( long long m, long long n, const float * A, long long lda, float * Q, long long ldq,
+                 float * R, long long ldr, int ro_steps, float * work, long long lwork );
+
+// NormInf(I-Q^T*Q) of m x n Q with the leading dimension ldq: the largest |entry| of I - Q^T*Q
+// (the loss of orthogonality reported by the program and the Python module)
+double pcgs_dorthogonality( long long m, long long n, const double * Q, long long ldq );
+double pcgs_sorthogonality( long long m, long long n, const float * Q, long long ldq );
+
+#ifdef __cplusplus
+}
+#endif